@@ -6,10 +6,22 @@ TEMPLATE = app
 
 SOURCES += main.cpp\
         debugview.cpp \
-        ../aircursor.cpp
+        ../aircursor.cpp \
+        ../gesturedetector.cpp \
+        ../handtrajectory.cpp \
+        ../depthcodec.cpp \
+        ../depthcapture.cpp \
+        ../aircursorlistener.cpp
 
 HEADERS += debugview.h \
-        ../aircursor.h
+        ../aircursor.h \
+        ../gesturedetector.h \
+        ../handtrajectory.h \
+        ../depthprojection.h \
+        ../aircursorkernels.h \
+        ../depthcodec.h \
+        ../depthcapture.h \
+        ../aircursorlistener.h
 
 INCLUDEPATH += /usr/include/ni
 DEPENDPATH += /usr/include/ni
@@ -7,17 +7,32 @@
     Part of the debug view example.
 
     A simple view widget.
-    Draws given QImage and QStrings on the screen.
+    Draws given QImage and QStrings, colorized depth or debug geometry on the screen.
 */
 
 #include "debugview.h"
 #include <QPainter>
 
+// with aircursor the debug image size is always 640x480
+const int IMAGE_WIDTH = 640;
+const int IMAGE_HEIGHT = 480;
+
+// how much new repaint times affect the running average
+const qreal PAINT_TIME_SMOOTHING = 0.05;
+
 DebugView::DebugView(QWidget *parent)
-    : QWidget(parent)
+    : QWidget(parent),
+      m_scaledPixmapValid(false),
+      m_font("arial", 30),
+      m_stringPathsValid(false),
+      m_paintTimeAverage(0.0),
+      m_paintTimeMax(0.0),
+      m_paintCount(0),
+      m_geometryEnabled(false)
 {
-    // with aircursor the size should always be 640x480
-    setFixedSize(640, 480);
+    resize(IMAGE_WIDTH, IMAGE_HEIGHT);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    m_font.setBold(true);
 
     m_strings.push_back(QString("Wave your hand to start"));
 }
@@ -28,32 +43,208 @@ DebugView::~DebugView()
 
 void DebugView::paintEvent(QPaintEvent *)
 {
+    m_paintTimer.start();
+
     QPainter painter(this);
+    QRect target = imageRect();
+
+    // scale the image and hand mask only when they or the widget size have changed
+    if (!m_scaledPixmapValid)
+    {
+        QImage composed(IMAGE_WIDTH, IMAGE_HEIGHT, QImage::Format_ARGB32_Premultiplied);
+        composed.fill(Qt::black);
+        QPainter composer(&composed);
+        if (!m_image.isNull()) composer.drawImage(0, 0, m_image);
+        if (!m_handMask.isNull()) composer.drawImage(0, 0, m_handMask);
+        composer.end();
+
+        m_scaledPixmap = QPixmap::fromImage(composed.scaled(target.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+        m_scaledPixmapValid = true;
+    }
+
+    // areas outside the image keep the aspect ratio
+    painter.fillRect(rect(), Qt::black);
+    painter.drawPixmap(target.topLeft(), m_scaledPixmap);
+
+    // overlays are drawn in debug image coordinates
+    painter.save();
+    painter.translate(target.topLeft());
+    painter.scale((qreal)target.width() / IMAGE_WIDTH, (qreal)target.height() / IMAGE_HEIGHT);
 
-    // first draw the actual image
-    painter.drawImage(0, 0, m_image);
+    if (m_geometryEnabled) drawGeometry(painter);
 
-    // draw debug strings starting from bottom
-    int y = 480 - 40;
-    for (unsigned int i = 0; i < m_strings.size(); i++)
+    // create glyph paths for the debug strings starting from bottom
+    if (!m_stringPathsValid)
     {
-        QPainterPath path;
-        QFont font("arial", 30);
-        font.setBold(true);
-        path.addText(10, y, font, m_strings.at(i));
+        m_stringPaths.clear();
+        int y = IMAGE_HEIGHT - 40;
+        for (int i = 0; i < m_strings.size(); i++)
+        {
+            QPainterPath path;
+            path.addText(10, y, m_font, m_strings.at(i));
+            m_stringPaths.push_back(path);
+            y -= 40;
+        }
+        m_stringPathsValid = true;
+    }
 
-        // text outline
-        painter.setPen(QPen(Qt::darkBlue, 2));
+    // text outline
+    painter.setPen(QPen(Qt::darkBlue, 2));
+    painter.setBrush(QBrush(Qt::blue));
+    for (int i = 0; i < m_stringPaths.size(); i++)
+    {
+        painter.drawPath(m_stringPaths.at(i));
+    }
+    painter.restore();
 
-        painter.setBrush(QBrush(Qt::blue));
-        painter.drawPath(path);
-        y -= 40;
+    // repaint time of the previous paints, this one is still going on
+    painter.setPen(Qt::white);
+    painter.drawText(10, 20, QString("paint: %1 ms avg, %2 ms max")
+                     .arg(m_paintTimeAverage, 0, 'f', 2).arg(m_paintTimeMax, 0, 'f', 2));
+    if (m_statistics.frames > 0)
+    {
+        painter.drawText(10, 40, QString("frame interval: %1 ms, scheduling jitter: %2 ms, max delay: %3 ms")
+                         .arg(m_statistics.frameInterval, 0, 'f', 2)
+                         .arg(m_statistics.schedulingJitter, 0, 'f', 2)
+                         .arg(m_statistics.maxSchedulingDelay, 0, 'f', 2));
+    }
+    if (m_statistics.analyzedFrames > 0)
+    {
+        painter.drawText(10, 60, QString("grab analysis: %1 ms, depth filters: %2 ms, grab transitions: %3")
+                         .arg(m_statistics.grabAnalysisTime, 0, 'f', 2)
+                         .arg(m_statistics.depthFilterTime, 0, 'f', 2)
+                         .arg(m_statistics.grabTransitions));
+    }
+    if (m_statistics.frames > 0)
+    {
+        painter.drawText(10, 80, QString("cpu: %1 % active, %2 % idle, idle frames: %3 (%4 skipped), wake latency: %5 ms")
+                         .arg(m_statistics.activeCpuLoad * 100.0, 0, 'f', 1)
+                         .arg(m_statistics.idleCpuLoad * 100.0, 0, 'f', 1)
+                         .arg(m_statistics.idleFrames)
+                         .arg(m_statistics.skippedFrames)
+                         .arg(m_statistics.wakeLatency, 0, 'f', 0));
     }
+    if (m_statistics.capturedFrames > 0)
+    {
+        painter.drawText(10, 100, QString("capture: %1 ms per frame, compression %2:1, %3 dropped")
+                         .arg(m_statistics.captureTime, 0, 'f', 2)
+                         .arg(m_statistics.captureRatio, 0, 'f', 2)
+                         .arg(m_statistics.droppedCaptureFrames));
+    }
+    if (!m_initStatus.isEmpty()) painter.drawText(10, 120, m_initStatus);
+    painter.end();
+
+    qreal paintTime = m_paintTimer.nsecsElapsed() / 1000000.0;
+    if (m_paintCount == 0) m_paintTimeAverage = paintTime;
+    else m_paintTimeAverage = (1.0 - PAINT_TIME_SMOOTHING) * m_paintTimeAverage + PAINT_TIME_SMOOTHING * paintTime;
+    if (paintTime > m_paintTimeMax) m_paintTimeMax = paintTime;
+    m_paintCount++;
+}
+
+void DebugView::resizeEvent(QResizeEvent *)
+{
+    m_scaledPixmapValid = false;
+}
+
+QRect DebugView::imageRect() const
+{
+    QSize size(IMAGE_WIDTH, IMAGE_HEIGHT);
+    size.scale(this->size(), Qt::KeepAspectRatio);
+
+    QRect target(QPoint(0, 0), size);
+    target.moveCenter(rect().center());
+    return target;
+}
+
+void DebugView::setStrings(const QList<QString>& strings)
+{
+    if (strings == m_strings) return;
+    m_strings = strings;
+    m_stringPathsValid = false;
 }
 
 void DebugView::debugUpdate(QImage image, QList<QString> strings)
 {  
     m_image = image;
-    m_strings = strings;
+    m_scaledPixmapValid = false;
+    setStrings(strings);
+    update();
+}
+
+void DebugView::debugGeometryUpdate(AirCursorDebugGeometry geometry)
+{
+    m_geometry = geometry;
+    m_geometryEnabled = true;
+
+    QList<QString> strings;
+    strings.push_back(QString("hand distance: %1 mm").arg(geometry.handDistance));
+    strings.push_back(QString("defects: %1").arg(geometry.numOfDefects));
+    setStrings(strings);
     update();
 }
+
+void DebugView::debugDepthUpdate(QImage depth, QImage handMask, bool grabbing)
+{
+    m_image = depth;
+    m_handMask = handMask;
+    m_scaledPixmapValid = false;
+
+    // tint hand with half transparent green for normal and red for grab
+    QVector<QRgb> colors(2);
+    colors[0] = qRgba(0, 0, 0, 0);
+    colors[1] = grabbing ? qRgba(255, 0, 0, 128) : qRgba(0, 255, 0, 128);
+    m_handMask.setColorTable(colors);
+
+    if (!m_geometryEnabled) setStrings(QList<QString>());
+    update();
+}
+
+void DebugView::statisticsUpdate(AirCursorStatistics statistics)
+{
+    m_statistics = statistics;
+    update();
+}
+
+void DebugView::initProgress(QString phase, int step, int steps, qreal time)
+{
+    if (step == 1) m_initStatus = "init:";
+    m_initStatus += QString(" %1 %2 ms").arg(phase).arg(time, 0, 'f', 0);
+    if (step < steps) m_initStatus += ",";
+    update();
+}
+
+void DebugView::initReady(qreal time)
+{
+    m_initStatus += QString(", total %1 ms").arg(time, 0, 'f', 0);
+    update();
+}
+
+// draws the same overlays air cursor draws to its debug image
+void DebugView::drawGeometry(QPainter& painter)
+{
+    // green for normal and red for grab
+    QColor color = m_geometry.grabbing ? QColor(Qt::red) : QColor(Qt::green);
+
+    painter.setBrush(Qt::NoBrush);
+    painter.setPen(QPen(Qt::darkGray, 1, Qt::DashLine));
+    painter.drawRect(m_geometry.roi);
+
+    painter.setPen(QPen(color, 1));
+    for (int i = 0; i < m_geometry.contours.size(); i++)
+    {
+        painter.drawPolygon(m_geometry.contours.at(i));
+    }
+    painter.drawPolygon(m_geometry.hull);
+
+    // defect points with blue
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QBrush(Qt::blue));
+    for (int i = 0; i < m_geometry.defects.size(); i++)
+    {
+        painter.drawEllipse(m_geometry.defects.at(i), 5, 5);
+    }
+
+    // current hand position with white
+    painter.setBrush(QBrush(Qt::white));
+    painter.drawEllipse(m_geometry.handPoint, 5, 5);
+}
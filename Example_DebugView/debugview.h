@@ -7,7 +7,7 @@
     Part of the debug view example.
 
     A simple view widget.
-    Draws given QImage and QStrings on the screen.
+    Draws given QImage and QStrings, colorized depth or debug geometry on the screen.
 */
 
 #ifndef DEBUGVIEW_H
@@ -15,6 +15,11 @@
 
 #include <QtGui/QWidget>
 #include <QImage>
+#include <QPixmap>
+#include <QPainterPath>
+#include <QElapsedTimer>
+
+#include "aircursor.h"
 
 class DebugView : public QWidget
 {
@@ -25,15 +30,59 @@ public:
     ~DebugView();
 
     void paintEvent(QPaintEvent *);
+    void resizeEvent(QResizeEvent *);
 
 public slots:
 
     // called when air cursor's debug image is updated
     void debugUpdate(QImage image, QList<QString> strings);
 
+    // called when air cursor's debug geometry is updated
+    void debugGeometryUpdate(AirCursorDebugGeometry geometry);
+
+    // called when air cursor's grayscale depth and hand mask are updated
+    void debugDepthUpdate(QImage depth, QImage handMask, bool grabbing);
+
+    // called periodically with air cursor's tracker thread timing
+    void statisticsUpdate(AirCursorStatistics statistics);
+
+    // called while air cursor is initializing and when it's done, times in ms
+    void initProgress(QString phase, int step, int steps, qreal time);
+    void initReady(qreal time);
+
 private:
+    void drawGeometry(QPainter& painter);
+    void setStrings(const QList<QString>& strings);
+
+    // area of the widget where the 640x480 debug image is drawn keeping aspect ratio
+    QRect imageRect() const;
+
     QImage m_image;
+    QImage m_handMask;
     QList<QString> m_strings;
+
+    // image and mask scaled to the current widget size, rebuilt only when they change
+    QPixmap m_scaledPixmap;
+    bool m_scaledPixmapValid;
+
+    // debug strings as glyph paths, rebuilt only when the strings change
+    QFont m_font;
+    QList<QPainterPath> m_stringPaths;
+    bool m_stringPathsValid;
+
+    // repaint time counter
+    QElapsedTimer m_paintTimer;
+    qreal m_paintTimeAverage;
+    qreal m_paintTimeMax;
+    quint32 m_paintCount;
+
+    AirCursorStatistics m_statistics;
+
+    // init phase times
+    QString m_initStatus;
+
+    AirCursorDebugGeometry m_geometry;
+    bool m_geometryEnabled;
 };
 
 #endif // DEBUGVIEW_H
@@ -19,20 +19,64 @@ int main(int argc, char *argv[])
     DebugView view;
     view.show();
 
-    // init air cursor with debug image creation (true)
+    // with --geometry and/or --depth air cursor sends debug geometry and grayscale depth
+    // with hand mask instead of the rendered image, and the view draws them
+    AirCursor::DebugModes debugMode = AirCursor::DebugNone;
+    if (app.arguments().contains("--geometry")) debugMode |= AirCursor::DebugGeometry;
+    if (app.arguments().contains("--depth")) debugMode |= AirCursor::DebugDepth;
+    if (debugMode == AirCursor::DebugNone) debugMode = AirCursor::DebugImage;
+
+    // init air cursor with debug data creation
     AirCursor ac;
-    std::cout << "Initializing Kinect... " << std::flush;
-    if (!ac.init(true))
+
+    // with --realtime tracker thread runs with fifo scheduling and locked memory
+    if (app.arguments().contains("--realtime"))
+    {
+        ac.setScheduling(AirCursor::SchedulingFifo, 50);
+        ac.setLockMemory(true);
+    }
+
+    // with --idle only every third frame is processed while nobody is in a session
+    if (app.arguments().contains("--idle"))
+    {
+        ac.setIdlePolicy(AirCursor::IdleSkipFrames);
+    }
+
+    // with --filter the hand region is denoised before grab analysis
+    if (app.arguments().contains("--filter"))
+    {
+        ac.setDepthFilters(AirCursor::FilterHoleFill | AirCursor::FilterMedian | AirCursor::FilterMorphology);
+    }
+
+    // with --capture file.acd every depth frame is compressed and saved with the hand point
+    int captureIndex = app.arguments().indexOf("--capture");
+    if (captureIndex >= 0 && captureIndex + 1 < app.arguments().size())
+    {
+        ac.setCapture(app.arguments().at(captureIndex + 1));
+    }
+
+    // connect debug update signals from air cursor
+    if (debugMode.testFlag(AirCursor::DebugGeometry))
+    {
+        QObject::connect(&ac, SIGNAL(debugGeometryUpdate(AirCursorDebugGeometry)), &view, SLOT(debugGeometryUpdate(AirCursorDebugGeometry)));
+    }
+    if (debugMode.testFlag(AirCursor::DebugDepth))
+    {
+        QObject::connect(&ac, SIGNAL(debugDepthUpdate(QImage, QImage, bool)), &view, SLOT(debugDepthUpdate(QImage, QImage, bool)), Qt::BlockingQueuedConnection);
+    }
+    if (debugMode.testFlag(AirCursor::DebugImage))
     {
-        return 0;
+        QObject::connect(&ac, SIGNAL(debugUpdate(QImage, QList<QString>)), &view, SLOT(debugUpdate(QImage, QList<QString>)), Qt::BlockingQueuedConnection);
     }
-    std::cout << "ok" << std::endl;
 
-    // connect debug update signal from air cursor
-    QObject::connect(&ac, SIGNAL(debugUpdate(QImage, QList<QString>)), &view, SLOT(debugUpdate(QImage, QList<QString>)), Qt::BlockingQueuedConnection);
+    QObject::connect(&ac, SIGNAL(statisticsUpdate(AirCursorStatistics)), &view, SLOT(statisticsUpdate(AirCursorStatistics)));
 
-    // for air cursor to work, start needs to be called first
-    ac.start();
+    // kinect is initialized on the tracker thread while the view is already running,
+    // the view shows how long each init phase took
+    QObject::connect(&ac, SIGNAL(initProgress(QString, int, int, qreal)), &view, SLOT(initProgress(QString, int, int, qreal)));
+    QObject::connect(&ac, SIGNAL(initReady(qreal)), &view, SLOT(initReady(qreal)));
+    QObject::connect(&ac, SIGNAL(initFailed(QString)), &app, SLOT(quit()));
+    ac.initAsync(debugMode);
 
     return app.exec();
 }
@@ -3,15 +3,29 @@ QT       += core gui
 HEADERS += \
     game.h \
     item.h \
+    itempool.h \
     button.h \
-    ../aircursor.h
+    ../aircursor.h \
+    ../gesturedetector.h \
+    ../handtrajectory.h \
+    ../depthprojection.h \
+    ../aircursorkernels.h \
+    ../depthcodec.h \
+    ../depthcapture.h \
+    ../aircursorlistener.h
 
 SOURCES += \
     game.cpp \
     main.cpp \
     item.cpp \
+    itempool.cpp \
     button.cpp \
-    ../aircursor.cpp
+    ../aircursor.cpp \
+    ../gesturedetector.cpp \
+    ../handtrajectory.cpp \
+    ../depthcodec.cpp \
+    ../depthcapture.cpp \
+    ../aircursorlistener.cpp
 
 INCLUDEPATH += /usr/include/ni
 DEPENDPATH += /usr/include/ni
@@ -11,11 +11,21 @@
 
 #include "game.h"
 #include "button.h"
+#include "aircursor.h"
 
 #include <QCoreApplication>
 #include <QTime>
+#include <QImage>
+#include <iostream>
 
-const quint16 FPS = 30;
+// simulation runs at fixed rate, rendering as often as the display refreshes
+const quint16 SIMULATION_FPS = 30;
+const qreal SIMULATION_STEP = 1000.0 / SIMULATION_FPS;
+const quint16 RENDER_FPS = 60;
+
+// max simulation steps run per rendered frame, rest of the time is dropped
+// so that a long stall doesn't make the game run fast forward
+const quint16 MAX_SIMULATION_STEPS = 5;
 
 // determine how much hand needs to move in mm to reach screen boundaries
 const qreal KINECT_X_RANGE = 250;
@@ -48,17 +58,20 @@ const QString KINECT_IN_SESSION_TEXT = "Kinect tracking.";
 const QString KINECT_TOO_NEAR_TEXT = "Hand too near, please move it back a bit.";
 const QString KINECT_TOO_FAR_TEXT = "Hand too far, please move it forwards a bit.";
 
-Game::Game(QSize size, QObject *parent) :
+Game::Game(QSize size, bool headless, QObject *parent) :
     QObject(parent),
     m_size(size),
     m_gameScene(0),
     m_menuScene(0),
     m_view(0),
+    m_airCursor(0),
     m_gameInProgress(0),
+    m_benchmarkMode(false),
+    m_simulationAccumulator(0.0),
     m_itemSpawnInterval(START_ITEM_SPAWN_INTERVAL),
     m_currentSpeed(START_SPEED),
-    m_points(0),
-    m_grabbedItem(0)
+    m_grabbedItem(0),
+    m_points(0)
 {
     m_mousePixmap = new QPixmap("img/mouse.png");
     m_joystickPixmap = new QPixmap("img/joystick.png");
@@ -77,15 +90,18 @@ Game::Game(QSize size, QObject *parent) :
     m_view->setRenderHint(QPainter::Antialiasing);
     m_view->setCacheMode(QGraphicsView::CacheBackground);
     m_view->setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
-    m_view->showFullScreen();
     m_view->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     m_view->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    m_view->show();
+    if (!headless)
+    {
+        m_view->showFullScreen();
+        m_view->show();
+    }
 
     // connect timers
     QObject::connect(&m_speedIncreaseTimer, SIGNAL(timeout()), this, SLOT(speedIncrease()));
     QObject::connect(&m_itemSpawnTimer, SIGNAL(timeout()), this, SLOT(itemSpawn()));
-    QObject::connect(&m_gameTimer, SIGNAL(timeout()), m_gameScene, SLOT(advance()));
+    QObject::connect(&m_frameTimer, SIGNAL(timeout()), this, SLOT(frame()));
 
     // texts at the beginning
     QString str("GRAB TO THE FUTURE\n\nGrab ancient control devices and throw them in trash bin before they escape and degenerate the world!");
@@ -125,8 +141,15 @@ Game::~Game()
     delete m_cursorClosedPixmap;
 }
 
+void Game::setAirCursor(AirCursor* airCursor)
+{
+    m_airCursor = airCursor;
+}
+
 void Game::start()
 {
+    // keep pooled items alive over scene clearing
+    m_itemPool.removeFromScene();
     m_gameScene->clear();
 
     // add trashbin images
@@ -151,7 +174,9 @@ void Game::start()
     // start timers
     m_speedIncreaseTimer.start(1000);
     m_itemSpawnTimer.start(m_itemSpawnInterval);
-    m_gameTimer.start(1000.0 / FPS);
+    m_simulationAccumulator = 0.0;
+    m_frameClock.start();
+    m_frameTimer.start(1000.0 / RENDER_FPS);
 
     // texts at the top
     //addTextItem("GRAB TO THE FUTURE", QPoint(-m_size.width() / 4, -m_size.height() / 2 + 2), QColor(Qt::darkRed), 32);
@@ -219,8 +244,6 @@ void Game::handUpdate(qreal x, qreal y, qreal z)
     // if an item is grabbed update it's location also
     if (m_gameInProgress && m_grabbedItem)
     {
-        m_lastCursorPos = m_grabbedItem->scenePos();
-
         // keep item inside screen
         QPointF newPoint = QPointF(x, y);
         if (newPoint.x() < -m_size.width() / 2) {
@@ -229,7 +252,7 @@ void Game::handUpdate(qreal x, qreal y, qreal z)
         if (newPoint.x() > m_size.width() / 2) {
             newPoint.setX(m_size.width() / 2);
         }
-        m_grabbedItem->setPos(newPoint);
+        m_grabbedItem->setSimulationPos(newPoint);
     }
 }
 
@@ -264,11 +287,11 @@ void Game::grab(qreal x, qreal y)
         {
             Item* item;
             item = dynamic_cast<Item*>(items.at(i));
-            if (item)
+            if (item && item->isVisible())
             {
                 item->grab();
                 m_grabbedItem = item;
-                item->setPos(x, y);
+                item->setSimulationPos(QPointF(x, y));
                 return;
             }
             else
@@ -296,14 +319,55 @@ void Game::grabRelease(qreal x, qreal y)
 
         m_grabbedItem->grabRelease();
 
-        // set item velocity based on two last cursor points
-        QPointF vel = m_lastCursorPos - newPoint;
-        m_grabbedItem->setVelocity(-vel * 0.5);
+        // set item velocity based on hand velocity at the time of the release,
+        // converted from mm/s to scene units per simulation step
+        HandTrajectory::Sample latest;
+        qreal vx, vy, vz;
+        // trajectory of the sensor that saw the release
+        AirCursor* airCursor = qobject_cast<AirCursor*>(sender());
+        if (!airCursor) airCursor = m_airCursor;
+        const HandTrajectory* trajectory = airCursor ? &airCursor->trajectory() : 0;
+        if (trajectory && trajectory->latest(latest) && trajectory->velocityAt(latest.time, vx, vy, vz))
+        {
+            mapKinectToScene(vx, vy);
+            m_grabbedItem->setVelocity(QPointF(vx, vy) / SIMULATION_FPS * 0.5);
+        }
 
     }
     m_grabbedItem = 0;
 }
 
+// called at render rate, steps the simulation with fixed timestep for the real time
+// elapsed and moves items to their interpolated positions between the last two steps
+void Game::frame()
+{
+    m_simulationAccumulator += m_frameClock.nsecsElapsed() / 1000000.0;
+    m_frameClock.start();
+
+    quint16 steps = 0;
+    while (m_simulationAccumulator >= SIMULATION_STEP)
+    {
+        if (steps == MAX_SIMULATION_STEPS)
+        {
+            m_simulationAccumulator = 0.0;
+            break;
+        }
+
+        m_gameScene->advance();
+        m_simulationAccumulator -= SIMULATION_STEP;
+        steps++;
+
+        // game over stops the frame timer during advance
+        if (!m_gameInProgress) return;
+    }
+
+    qreal alpha = m_simulationAccumulator / SIMULATION_STEP;
+    const QVector<Item*>& items = m_itemPool.activeItems();
+    for (int i = 0; i < items.size(); i++)
+    {
+        items.at(i)->interpolate(alpha);
+    }
+}
 
 void Game::speedIncrease()
 {
@@ -314,22 +378,38 @@ void Game::itemSpawn()
 {
     if (!m_gameInProgress) return;
 
-    // create a new item to the scene
-    Item* newItem = 0;
+    QPixmap* pixmap = 0;
+    QPointF size;
     switch (qrand() % 3)
     {
         case 0:
-            newItem = new Item(m_mousePixmap, QPointF(MOUSE_SIZE * m_size.height(), MOUSE_SIZE * m_size.height()));
+            pixmap = m_mousePixmap;
+            size = QPointF(MOUSE_SIZE * m_size.height(), MOUSE_SIZE * m_size.height());
             break;
         case 1:
-            newItem = new Item(m_joystickPixmap, QPointF(JOYSTICK_SIZE * m_size.height(), JOYSTICK_SIZE * m_size.height()));
+            pixmap = m_joystickPixmap;
+            size = QPointF(JOYSTICK_SIZE * m_size.height(), JOYSTICK_SIZE * m_size.height());
             break;
         case 2:
-            newItem = new Item(m_tabletPixmap, QPointF(TABLET_SIZE * m_size.height() * 1.2, TABLET_SIZE * m_size.height()));
+            pixmap = m_tabletPixmap;
+            size = QPointF(TABLET_SIZE * m_size.height() * 1.2, TABLET_SIZE * m_size.height());
             break;
         default:
             break;
     }
+
+    // reuse a retired item if there is one, otherwise create a new item to the scene
+    Item* newItem = m_itemPool.acquire(pixmap, size);
+    if (!newItem)
+    {
+        newItem = new Item(pixmap, size);
+        QObject::connect(newItem, SIGNAL(wentToTrash()), this, SLOT(pointIncrease()));
+        QObject::connect(newItem, SIGNAL(escape()), this, SLOT(gameOver()));
+        QObject::connect(newItem, SIGNAL(retired(Item*)), this, SLOT(itemRetired(Item*)));
+        m_itemPool.add(newItem);
+    }
+    if (newItem->scene() != m_gameScene) m_gameScene->addItem(newItem);
+
     qreal trashBoundaryInPixels = TRASH_BOUNDARY * m_size.width();
 
     // set item's x position at random pos between trash bins
@@ -338,15 +418,10 @@ void Game::itemSpawn()
     // set item's y position to screen bottom
     qreal yPos = m_gameScene->sceneRect().bottom() + newItem->getSize().y() / 2;
 
-    newItem->setPos(xPos, yPos);
+    newItem->setSimulationPos(QPointF(xPos, yPos));
     newItem->setSpeed(m_currentSpeed);
     newItem->setTrashBoundary(trashBoundaryInPixels);
 
-    QObject::connect(newItem, SIGNAL(wentToTrash()), this, SLOT(pointIncrease()));
-    QObject::connect(newItem, SIGNAL(escape()), this, SLOT(gameOver()));
-
-    m_gameScene->addItem(newItem);
-
     // make items birth faster
     m_itemSpawnInterval -= ITEM_SPAWN_INTERVAL_STEP;
     if (m_itemSpawnInterval < 1000) m_itemSpawnInterval = 1000;
@@ -354,6 +429,11 @@ void Game::itemSpawn()
     m_itemSpawnTimer.start(m_itemSpawnInterval);
 }
 
+void Game::itemRetired(Item* item)
+{
+    m_itemPool.release(item);
+}
+
 // adds text item to the scene with center given in param position
 QGraphicsTextItem* Game::addTextItem(QString text, QPoint position, QColor color, quint16 fontSize)
 {
@@ -394,9 +474,12 @@ void Game::pointIncrease()
 
 void Game::gameOver()
 {
+    // benchmark keeps running, escaped items are replaced with new ones
+    if (m_benchmarkMode) return;
+
     m_speedIncreaseTimer.stop();
     m_itemSpawnTimer.stop();
-    m_gameTimer.stop();
+    m_frameTimer.stop();
 
     m_gameInProgress = false;
     if (m_grabbedItem)
@@ -430,4 +513,70 @@ void Game::gameOver()
     QObject::connect(button, SIGNAL(activated()), QCoreApplication::instance(), SLOT(quit()));
 }
 
+void Game::runBenchmark(quint32 itemCount, quint32 frames, bool useIndex)
+{
+    m_benchmarkMode = true;
+    start();
+
+    // frames are driven directly from here, not from timers
+    m_frameTimer.stop();
+    m_itemSpawnTimer.stop();
+    m_speedIncreaseTimer.stop();
+
+    if (!useIndex) m_gameScene->setItemIndexMethod(QGraphicsScene::NoIndex);
+
+    QImage image(m_size, QImage::Format_ARGB32_Premultiplied);
+    QElapsedTimer timer;
 
+    qreal totalSimulation = 0.0;
+    qreal totalPaint = 0.0;
+
+    std::cout << "frame items simulation_ms paint_ms" << std::endl;
+    for (quint32 frame = 0; frame < frames; frame++)
+    {
+        // replace items that went to trash or escaped
+        quint32 items = m_itemPool.activeCount();
+        while (items < itemCount)
+        {
+            itemSpawn();
+            items++;
+        }
+
+        // one simulation step and moving items to their rendered positions
+        timer.start();
+        m_gameScene->advance();
+        const QVector<Item*>& activeItems = m_itemPool.activeItems();
+        for (int i = 0; i < activeItems.size(); i++)
+        {
+            activeItems.at(i)->interpolate(1.0);
+        }
+        qreal simulationMs = timer.nsecsElapsed() / 1000000.0;
+
+        // paint the whole scene offscreen
+        timer.start();
+        image.fill(Qt::black);
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        m_gameScene->render(&painter);
+        painter.end();
+        qreal paintMs = timer.nsecsElapsed() / 1000000.0;
+
+        totalSimulation += simulationMs;
+        totalPaint += paintMs;
+
+        std::cout << frame << " " << items << " " << simulationMs << " " << paintMs << std::endl;
+    }
+
+    if (frames > 0)
+    {
+        std::cout << "average simulation: " << totalSimulation / frames << " ms, "
+                  << "paint: " << totalPaint / frames << " ms, "
+                  << "index: " << (useIndex ? "bsp" : "none") << std::endl;
+    }
+    std::cout << "item pool created: " << m_itemPool.createdCount()
+              << ", reused: " << m_itemPool.reusedCount()
+              << ", released: " << m_itemPool.releasedCount()
+              << ", peak active: " << m_itemPool.peakActiveCount() << std::endl;
+
+    m_benchmarkMode = false;
+}
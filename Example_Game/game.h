@@ -16,15 +16,27 @@
 #include <QGraphicsScene>
 #include <QGraphicsView>
 #include <QTimer>
+#include <QElapsedTimer>
 #include "item.h"
+#include "itempool.h"
+
+class AirCursor;
 
 class Game : public QObject
 {
     Q_OBJECT
 public:
-    explicit Game(QSize size, QObject *parent = 0);
+    explicit Game(QSize size, bool headless = false, QObject *parent = 0);
     ~Game();
 
+    // air cursor whose hand trajectory is used for throw velocities when the release
+    // doesn't come from an air cursor signal
+    void setAirCursor(AirCursor* airCursor);
+
+    // runs the game scene without sensor or visible window keeping given amount of
+    // items alive, and prints simulation and paint times of each frame
+    void runBenchmark(quint32 itemCount, quint32 frames, bool useIndex = true);
+
 
 signals:
 
@@ -42,8 +54,10 @@ public slots:
     void gameOver();
 
 private slots:
+    void frame();
     void speedIncrease();
     void itemSpawn();
+    void itemRetired(Item* item);
 
 private:
 
@@ -65,17 +79,24 @@ private:
     QPixmap* m_cursorClosedPixmap;
 
     QGraphicsPixmapItem* m_cursor;
-    QPointF m_lastCursorPos;
+
+    AirCursor* m_airCursor;
 
     bool m_gameInProgress;
+    bool m_benchmarkMode;
+
+    // render timer, simulation is stepped from it with a fixed timestep
+    QTimer m_frameTimer;
+    QElapsedTimer m_frameClock;
+    qreal m_simulationAccumulator;
 
-    QTimer m_gameTimer;
     QTimer m_itemSpawnTimer;
     QTimer m_speedIncreaseTimer;
 
     quint16 m_itemSpawnInterval;
     qreal m_currentSpeed;
     Item* m_grabbedItem;
+    ItemPool m_itemPool;
 
     quint16 m_points;
 
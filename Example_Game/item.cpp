@@ -12,19 +12,28 @@
 #include "item.h"
 #include <QVector>
 #include <QGraphicsScene>
+#include <QTransform>
 
 Item::Item(QPixmap* pixmap, QPointF size, QGraphicsObject *parent) :
     QGraphicsObject(parent),
     m_pixmap(pixmap),
     m_size(size),
+    m_simPos(QPointF(0.0, 0.0)),
+    m_simRotation(0.0),
     m_zCoord(0.0),
+    m_prevPos(QPointF(0.0, 0.0)),
+    m_prevRotation(0.0),
+    m_prevZCoord(0.0),
+    m_renderZCoord(0.0),
     m_speed(0.0),
     m_velocity(QPointF(0.0, 0.0)),
     m_zVelocity(0.0),
     m_targetAngle(0.0),
     m_onGround(false),
     m_grabbed(false),
-    m_trashBoundary(0.0)
+    m_trashBoundary(0.0),
+    m_alive(true),
+    m_poolIndex(-1)
 {
 
 }
@@ -34,6 +43,38 @@ Item::~Item()
 
 }
 
+void Item::reset(QPixmap* pixmap, QPointF size)
+{
+    if (size != m_size) prepareGeometryChange();
+    m_pixmap = pixmap;
+    m_size = size;
+
+    m_simPos = m_prevPos = QPointF(0.0, 0.0);
+    m_simRotation = m_prevRotation = 0.0;
+    m_zCoord = m_prevZCoord = m_renderZCoord = 0.0;
+    m_speed = 0.0;
+    m_velocity = QPointF(0.0, 0.0);
+    m_zVelocity = 0.0;
+    m_targetAngle = 0.0;
+    m_onGround = false;
+    m_grabbed = false;
+    m_alive = true;
+
+    setRotation(0.0);
+    setZValue(0.0);
+    setVisible(true);
+    update();
+}
+
+// item has left the game, it is hidden instead of removed from the scene
+// because this is called in the middle of scene advance
+void Item::retire()
+{
+    m_alive = false;
+    setVisible(false);
+    emit retired(this);
+}
+
 void Item::setSpeed(qreal speed)
 {
     m_speed = speed;
@@ -64,7 +105,7 @@ QPainterPath Item::shape() const
 void Item::paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
         QWidget* widget)
 {
-    qreal zCoeff = 5.0 / (5.0 - m_zCoord); //coeff = 1.0f;
+    qreal zCoeff = 5.0 / (5.0 - m_renderZCoord); //coeff = 1.0f;
 
     QRect target(-m_size.x() / 2 * zCoeff, -m_size.y() / 2 * zCoeff, m_size.x() * zCoeff, m_size.y() * zCoeff);
     painter->drawPixmap(target, *m_pixmap);
@@ -73,12 +114,21 @@ void Item::paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
 
 void Item::advance(int step)
 {
-    if (!step) return;
+    if (!m_alive) return;
+
+    if (!step)
+    {
+        // store state of the previous step for render interpolation
+        m_prevPos = m_simPos;
+        m_prevRotation = m_simRotation;
+        m_prevZCoord = m_zCoord;
+        return;
+    }
 
     if (m_grabbed)
     {
         // item is grabbed, struggle a bit
-        setRotation(rotation() + (qreal)qrand()/(qreal)RAND_MAX * 20 - 10);
+        m_simRotation += (qreal)qrand()/(qreal)RAND_MAX * 20 - 10;
         return;
     }
 
@@ -116,24 +166,24 @@ void Item::advance(int step)
     }
 
     // turn toward target angle
-    qreal angleDiff = m_targetAngle - rotation();
+    qreal angleDiff = m_targetAngle - m_simRotation;
     qreal angleStep = m_speed * 0.5;
 
     if (angleDiff < 0) angleStep = -angleStep;
     if (abs(angleDiff) > angleStep)
     {
-        setRotation(rotation() + angleStep);
+        m_simRotation += angleStep;
     }
     else
     {
         // target angle reached, create a new one
-        setRotation(m_targetAngle);
+        m_simRotation = m_targetAngle;
         m_targetAngle = ((qreal)qrand()/(qreal)RAND_MAX) * 120.0 - 60.0;
 
     }
 
     // check if item hits trashbin
-    if (pos().x() < scene()->sceneRect().left() + m_trashBoundary)
+    if (m_simPos.x() < scene()->sceneRect().left() + m_trashBoundary)
     {
         if (m_zCoord < 0.1)
         {
@@ -145,10 +195,11 @@ void Item::advance(int step)
         {
 
            emit wentToTrash();
-           deleteLater();
+           retire();
+           return;
         }
     }
-    else if (pos().x() > scene()->sceneRect().right() - m_trashBoundary)
+    else if (m_simPos.x() > scene()->sceneRect().right() - m_trashBoundary)
     {
         if (m_zCoord < 0.1)
         {
@@ -159,18 +210,19 @@ void Item::advance(int step)
         else
         {
            emit wentToTrash();
-           deleteLater();
+           retire();
+           return;
         }
     }
 
     // go forward
-    if (m_onGround) setPos(mapToParent(0, -m_speed));
+    if (m_onGround) m_simPos += QTransform().rotate(m_simRotation).map(QPointF(0, -m_speed));
 
     // check if item is past upper boundary of the screen
-    if (pos().y() < scene()->sceneRect().top())
+    if (m_simPos.y() < scene()->sceneRect().top())
     {
         emit escape();
-        deleteLater();
+        retire();
     }
 }
 
@@ -192,4 +244,29 @@ void Item::setVelocity(QPointF velocity)
     m_velocity = velocity;
 }
 
+void Item::setSimulationPos(QPointF pos)
+{
+    m_simPos = pos;
+    m_prevPos = pos;
+    setPos(pos);
+}
+
+QPointF Item::simulationPos() const
+{
+    return m_simPos;
+}
+
+void Item::interpolate(qreal alpha)
+{
+    setPos(m_prevPos + (m_simPos - m_prevPos) * alpha);
+    setRotation(m_prevRotation + (m_simRotation - m_prevRotation) * alpha);
+
+    qreal zCoord = m_prevZCoord + (m_zCoord - m_prevZCoord) * alpha;
+    if (zCoord != m_renderZCoord)
+    {
+        m_renderZCoord = zCoord;
+        update();
+    }
+}
+
 
@@ -15,6 +15,8 @@
 #include <QGraphicsObject>
 #include <QPainter>
 
+class ItemPool;
+
 class Item : public QGraphicsObject
 {
     Q_OBJECT
@@ -22,10 +24,22 @@ public:
     explicit Item(QPixmap* pixmap, QPointF size, QGraphicsObject *parent = 0);
     ~Item();
 
+    // resets physics state so that pooled item can be spawned again
+    void reset(QPixmap* pixmap, QPointF size);
+
     void setSpeed(qreal speed);
     void setVelocity(QPointF velocity);
     void setTrashBoundary(qreal trashBoundary);
 
+    // position used by the fixed step simulation, setting it also moves
+    // the rendered item immediately without interpolation
+    void setSimulationPos(QPointF pos);
+    QPointF simulationPos() const;
+
+    // move rendered state between previous and current simulation step,
+    // alpha is the fraction of a step elapsed since the last one
+    void interpolate(qreal alpha);
+
     QPointF getSize();
 
     void grab();
@@ -40,14 +54,33 @@ signals:
     void wentToTrash();
     void escape();
 
+    // emitted when item has left the game and can be returned to the pool
+    void retired(Item* item);
+
 protected:
     void advance(int step);
 
 private:
+    friend class ItemPool;
+
+    void retire();
+
     QPixmap* m_pixmap;
     QPointF m_size;
 
+    // current simulation state
+    QPointF m_simPos;
+    qreal m_simRotation;
     qreal m_zCoord;
+
+    // simulation state of the previous step, used for interpolation
+    QPointF m_prevPos;
+    qreal m_prevRotation;
+    qreal m_prevZCoord;
+
+    // interpolated z coordinate used for painting
+    qreal m_renderZCoord;
+
     qreal m_speed;
     QPointF m_velocity;
     qreal m_zVelocity;
@@ -56,6 +89,12 @@ private:
     bool m_grabbed;
 
     qreal m_trashBoundary;
+
+    // false when item has retired and waits in the pool
+    bool m_alive;
+
+    // index in pool's active item list
+    int m_poolIndex;
 };
 
 #endif // ITEM_H
@@ -0,0 +1,130 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Part of the game example.
+
+    This class recycles retired items so that spawning doesn't need to
+    allocate new QObjects during the game.
+*/
+
+#include "itempool.h"
+#include <QGraphicsScene>
+
+ItemPool::ItemPool() :
+    m_created(0),
+    m_reused(0),
+    m_released(0),
+    m_peakActive(0)
+{
+
+}
+
+ItemPool::~ItemPool()
+{
+    // items still in a scene are deleted by the scene
+    for (int i = 0; i < m_free.size(); i++)
+    {
+        if (!m_free.at(i)->scene()) delete m_free.at(i);
+    }
+    for (int i = 0; i < m_active.size(); i++)
+    {
+        if (!m_active.at(i)->scene()) delete m_active.at(i);
+    }
+}
+
+Item* ItemPool::acquire(QPixmap* pixmap, QPointF size)
+{
+    if (m_free.isEmpty()) return 0;
+
+    Item* item = m_free.last();
+    m_free.pop_back();
+    item->reset(pixmap, size);
+
+    item->m_poolIndex = m_active.size();
+    m_active.push_back(item);
+    if ((quint32)m_active.size() > m_peakActive) m_peakActive = m_active.size();
+
+    m_reused++;
+    return item;
+}
+
+void ItemPool::add(Item* item)
+{
+    item->m_poolIndex = m_active.size();
+    m_active.push_back(item);
+    if ((quint32)m_active.size() > m_peakActive) m_peakActive = m_active.size();
+
+    m_created++;
+}
+
+void ItemPool::release(Item* item)
+{
+    int index = item->m_poolIndex;
+    if (index < 0 || index >= m_active.size() || m_active.at(index) != item) return;
+
+    // move last active item to the released item's place
+    Item* last = m_active.last();
+    m_active[index] = last;
+    last->m_poolIndex = index;
+    m_active.pop_back();
+
+    item->m_poolIndex = -1;
+    m_free.push_back(item);
+
+    m_released++;
+}
+
+void ItemPool::removeFromScene()
+{
+    while (!m_active.isEmpty())
+    {
+        Item* item = m_active.last();
+        item->m_alive = false;
+        item->setVisible(false);
+        release(item);
+    }
+
+    for (int i = 0; i < m_free.size(); i++)
+    {
+        Item* item = m_free.at(i);
+        if (item->scene()) item->scene()->removeItem(item);
+    }
+}
+
+const QVector<Item*>& ItemPool::activeItems() const
+{
+    return m_active;
+}
+
+quint32 ItemPool::createdCount() const
+{
+    return m_created;
+}
+
+quint32 ItemPool::reusedCount() const
+{
+    return m_reused;
+}
+
+quint32 ItemPool::releasedCount() const
+{
+    return m_released;
+}
+
+quint32 ItemPool::activeCount() const
+{
+    return m_active.size();
+}
+
+quint32 ItemPool::freeCount() const
+{
+    return m_free.size();
+}
+
+quint32 ItemPool::peakActiveCount() const
+{
+    return m_peakActive;
+}
@@ -0,0 +1,60 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Part of the game example.
+
+    This class recycles retired items so that spawning doesn't need to
+    allocate new QObjects during the game.
+*/
+
+#ifndef ITEMPOOL_H
+#define ITEMPOOL_H
+
+#include <QVector>
+#include "item.h"
+
+class ItemPool
+{
+public:
+    ItemPool();
+    ~ItemPool();
+
+    // returns a free item reset with given pixmap and size,
+    // or 0 if the pool is empty and a new item needs to be created
+    Item* acquire(QPixmap* pixmap, QPointF size);
+
+    // takes a newly created item into the pool as active
+    void add(Item* item);
+
+    // returns an item to the pool, item is kept hidden in its scene
+    void release(Item* item);
+
+    // releases all items and removes them from their scene,
+    // needs to be called before the scene is cleared
+    void removeFromScene();
+
+    // items currently in the game
+    const QVector<Item*>& activeItems() const;
+
+    // pool statistics
+    quint32 createdCount() const;
+    quint32 reusedCount() const;
+    quint32 releasedCount() const;
+    quint32 activeCount() const;
+    quint32 freeCount() const;
+    quint32 peakActiveCount() const;
+
+private:
+    QVector<Item*> m_active;
+    QVector<Item*> m_free;
+
+    quint32 m_created;
+    quint32 m_reused;
+    quint32 m_released;
+    quint32 m_peakActive;
+};
+
+#endif // ITEMPOOL_H
@@ -14,36 +14,102 @@
 
 #include <QtGui/QApplication>
 #include <QDesktopWidget>
+#include <QStringList>
+#include <QMatrix4x4>
 #include <iostream>
 
 #include "game.h"
 #include "aircursor.h"
 
+// default values for the benchmark mode
+const quint32 BENCHMARK_ITEMS = 2000;
+const quint32 BENCHMARK_FRAMES = 1000;
+const QSize BENCHMARK_SIZE = QSize(1920, 1080);
+
+// distance between side by side sensors in mm
+const qreal SENSOR_SPACING = 600.0;
+
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
 
+    // headless benchmark of the game scene, no kinect needed:
+    // GTTF --benchmark [items] [frames] [noindex]
+    QStringList args = app.arguments();
+    if (args.size() > 1 && args.at(1) == "--benchmark")
+    {
+        quint32 items = args.size() > 2 ? args.at(2).toUInt() : BENCHMARK_ITEMS;
+        quint32 frames = args.size() > 3 ? args.at(3).toUInt() : BENCHMARK_FRAMES;
+        bool useIndex = !args.contains("noindex");
+
+        Game benchmarkGame(BENCHMARK_SIZE, true);
+        benchmarkGame.runBenchmark(items, frames, useIndex);
+        return 0;
+    }
+
     // new full screen sized game instance
     Game game(QApplication::desktop()->screenGeometry().size());
 
-    // init air cursor
-    AirCursor ac;
-    std::cout << "Initializing Kinect... " << std::flush;
-    if (!ac.init())
+    // sensors to use: GTTF [--sensors count] [--recording file.oni ...] [--spacing mm] [--affinity]
+    // several sensors or recordings are placed side by side with given spacing
+    int sensorCount = 1;
+    QStringList recordings;
+    qreal spacing = SENSOR_SPACING;
+    for (int i = 1; i < args.size(); i++)
     {
-        return 0;
+        if (args.at(i) == "--sensors" && i + 1 < args.size()) sensorCount = args.at(++i).toInt();
+        else if (args.at(i) == "--spacing" && i + 1 < args.size()) spacing = args.at(++i).toDouble();
+        else if (args.at(i) == "--recording")
+        {
+            while (i + 1 < args.size() && !args.at(i + 1).startsWith("--")) recordings.push_back(args.at(++i));
+        }
     }
-    std::cout << "ok" << std::endl;
+    if (!recordings.isEmpty()) sensorCount = recordings.size();
+
+    // with --fast-acquisition players don't need to wave, nearest hand starts the session
+    bool fastAcquisition = args.contains("--fast-acquisition");
 
-    // connect signals from air cursor
-    QObject::connect(&ac, SIGNAL(handCreate(qreal,qreal,qreal,qreal)), &game, SLOT(handCreate()));
-    QObject::connect(&ac, SIGNAL(handDestroy(qreal)), &game, SLOT(handDestroy()));
-    QObject::connect(&ac, SIGNAL(handUpdate(qreal,qreal,qreal,qreal,bool)), &game, SLOT(handUpdate(qreal, qreal, qreal)));
-    QObject::connect(&ac, SIGNAL(grab(qreal,qreal,qreal)), &game, SLOT(grab(qreal, qreal)));
-    QObject::connect(&ac, SIGNAL(grabRelease(qreal,qreal,qreal)), &game, SLOT(grabRelease(qreal,qreal)));
+    // with --affinity each tracker thread is pinned to its own core
+    bool pinTrackers = args.contains("--affinity");
+
+    // with --idle trackers process only every third frame while waiting for players
+    bool idleThrottling = args.contains("--idle");
+
+    // init air cursors, one tracker thread per sensor
+    QList<AirCursor*> airCursors;
+    for (int i = 0; i < sensorCount; i++)
+    {
+        AirCursor* ac = new AirCursor;
+        airCursors.push_back(ac);
+
+        if (recordings.isEmpty()) ac->setDevice(i);
+        else ac->setRecording(recordings.at(i));
+
+        QMatrix4x4 transform;
+        transform.translate((i - (sensorCount - 1) / 2.0) * spacing, 0, 0);
+        ac->setTransform(transform);
+        if (pinTrackers) ac->setCpuAffinity(QList<int>() << i % QThread::idealThreadCount());
+        if (fastAcquisition) ac->setAcquisitionMode(AirCursor::AcquisitionNearestBlob);
+        if (idleThrottling) ac->setIdlePolicy(AirCursor::IdleSkipFrames);
+
+        // game can't be played with a sensor missing
+        QObject::connect(ac, SIGNAL(initFailed(QString)), &app, SLOT(quit()));
+
+        // connect signals from air cursor
+        QObject::connect(ac, SIGNAL(handCreate(qreal,qreal,qreal,qreal)), &game, SLOT(handCreate()));
+        QObject::connect(ac, SIGNAL(handDestroy(qreal)), &game, SLOT(handDestroy()));
+        QObject::connect(ac, SIGNAL(handRecovered(qreal,qreal,qreal,qreal)), &game, SLOT(handCreate()));
+        QObject::connect(ac, SIGNAL(handUpdate(qreal,qreal,qreal,qreal,bool)), &game, SLOT(handUpdate(qreal, qreal, qreal)));
+        QObject::connect(ac, SIGNAL(grab(qreal,qreal,qreal)), &game, SLOT(grab(qreal, qreal)));
+        QObject::connect(ac, SIGNAL(grabRelease(qreal,qreal,qreal)), &game, SLOT(grabRelease(qreal,qreal)));
+    }
+    game.setAirCursor(airCursors.first());
 
-    // for air cursor to work, start needs to be called first
-    ac.start();
+    // each sensor is initialized on its own tracker thread, so they open in parallel
+    // while the game is already on screen. tracking starts when init is done
+    for (int i = 0; i < airCursors.size(); i++) airCursors.at(i)->initAsync();
 
-    return app.exec();
+    int result = app.exec();
+    qDeleteAll(airCursors);
+    return result;
 }
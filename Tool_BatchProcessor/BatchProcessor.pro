@@ -0,0 +1,45 @@
+QT       += core gui
+
+TARGET = BatchProcessor
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+
+SOURCES += main.cpp \
+        batchprocessor.cpp \
+        sessionlog.cpp \
+        capturesession.cpp \
+        ../aircursor.cpp \
+        ../gesturedetector.cpp \
+        ../handtrajectory.cpp \
+        ../depthcodec.cpp \
+        ../depthcapture.cpp \
+        ../aircursorlistener.cpp
+
+HEADERS += batchprocessor.h \
+        sessionlog.h \
+        capturesession.h \
+        ../aircursorkernels.h \
+        ../aircursor.h \
+        ../gesturedetector.h \
+        ../handtrajectory.h \
+        ../depthprojection.h \
+        ../depthcodec.h \
+        ../depthcapture.h \
+        ../aircursorlistener.h
+
+INCLUDEPATH += /usr/include/ni
+DEPENDPATH += /usr/include/ni
+
+INCLUDEPATH += /usr/include/nite
+DEPENDPATH += /usr/include/nite
+
+INCLUDEPATH += /usr/include/opencv
+DEPENDPATH += /usr/include/opencv
+
+INCLUDEPATH += ../
+DEPENDPATH += ../
+
+LIBS += -lOpenNI -lXnVNite_1_5_2 -lXnVHandGenerator_1_5_2
+LIBS += -lopencv_core -lopencv_imgproc
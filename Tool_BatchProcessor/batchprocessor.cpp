@@ -0,0 +1,164 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Processes recorded sessions in parallel, one session per core at a time.
+
+    .oni recordings play through a full air cursor with OpenNI and NITE as
+    fast as they can be processed. .acd depth captures go through the grab
+    analysis only, with the hand points stored in the capture. Each session
+    has its own pipeline and event log, and a core is given the next session
+    as soon as its previous one finishes.
+*/
+
+#include <QFileInfo>
+#include <QDir>
+#include <QThread>
+#include <iostream>
+
+#include "batchprocessor.h"
+#include "capturesession.h"
+#include "sessionlog.h"
+
+// sensor frame rate, for comparing throughput to real time
+const qreal SENSOR_FPS = 30.0;
+
+BatchProcessor::BatchProcessor(const QStringList& sessions, const QString& outputDir, QObject *parent) :
+    QObject(parent),
+    m_pending(sessions),
+    m_outputDir(outputDir),
+    m_jobs(qMax(1, QThread::idealThreadCount())),
+    m_depthFilters(AirCursor::FilterNone),
+    m_sessions(0),
+    m_failures(0),
+    m_frames(0),
+    m_events(0)
+{
+}
+
+void BatchProcessor::setJobs(int jobs)
+{
+    m_jobs = qMax(1, jobs);
+}
+
+void BatchProcessor::setGrabParameters(const AirCursor::GrabParameters& parameters)
+{
+    m_grabParameters = parameters;
+}
+
+void BatchProcessor::setDepthFilters(AirCursor::DepthFilters filters)
+{
+    m_depthFilters = filters;
+}
+
+void BatchProcessor::start()
+{
+    std::cout << "session frames events grabs seconds fps" << std::endl;
+    m_timer.start();
+    while (m_running.size() < m_jobs && !m_pending.isEmpty()) startNext();
+    if (m_running.isEmpty()) printTotals();
+}
+
+void BatchProcessor::startNext()
+{
+    Session session;
+    session.fileName = m_pending.takeFirst();
+    session.thread = 0;
+    session.cursor = 0;
+    session.log = new SessionLog;
+    m_sessions++;
+
+    if (!startSession(session))
+    {
+        std::cout << QFileInfo(session.fileName).fileName().toLocal8Bit().constData() << " failed" << std::endl;
+        m_failures++;
+        delete session.cursor;
+        delete session.thread;
+        delete session.log;
+        return;
+    }
+    m_running << session;
+}
+
+bool BatchProcessor::startSession(Session& session)
+{
+    QFileInfo info(session.fileName);
+    if (!session.log->open(QDir(m_outputDir).filePath(info.completeBaseName() + ".log"))) return false;
+
+    if (info.suffix().toLower() == "acd")
+    {
+        session.thread = new CaptureSession(session.fileName, m_grabParameters, m_depthFilters, session.log);
+    }
+    else
+    {
+        // recordings are played as fast as they are processed and the thread ends at their end
+        session.cursor = new AirCursor;
+        session.cursor->setRecording(session.fileName, AirCursor::PlaybackFastest);
+        session.cursor->setGrabParameters(m_grabParameters);
+        session.cursor->setDepthFilters(m_depthFilters);
+        if (!session.cursor->init(AirCursor::DebugNone)) return false;
+        session.log->connectTo(session.cursor);
+        session.thread = session.cursor;
+    }
+
+    // finished is emitted from the session thread and queued to this one
+    connect(session.thread, SIGNAL(finished()), SLOT(sessionFinished()));
+    session.timer.start();
+    session.thread->start();
+    return true;
+}
+
+void BatchProcessor::sessionFinished()
+{
+    for (int i = 0; i < m_running.size(); i++)
+    {
+        Session& session = m_running[i];
+        if (session.thread != sender()) continue;
+
+        session.thread->wait();
+        qreal seconds = session.timer.nsecsElapsed() / 1000000000.0;
+        session.log->close();
+
+        // a recording that stopped before its end couldn't be read
+        CaptureSession* capture = qobject_cast<CaptureSession*>(session.thread);
+        bool ok = capture ? capture->ok() : session.cursor->recordingEnded();
+        if (!ok)
+        {
+            std::cout << QFileInfo(session.fileName).fileName().toLocal8Bit().constData() << " failed" << std::endl;
+            m_failures++;
+        }
+        else
+        {
+            std::cout << QFileInfo(session.fileName).fileName().toLocal8Bit().constData() << " "
+                      << session.log->frames() << " "
+                      << session.log->events() << " "
+                      << session.log->grabs() << " "
+                      << seconds << " "
+                      << (seconds > 0.0 ? session.log->frames() / seconds : 0.0) << std::endl;
+        }
+        m_frames += session.log->frames();
+        m_events += session.log->events();
+
+        // the air cursor is the thread itself for recordings
+        delete session.thread;
+        delete session.log;
+        m_running.removeAt(i);
+        break;
+    }
+
+    if (!m_pending.isEmpty()) startNext();
+    if (m_running.isEmpty() && m_pending.isEmpty()) printTotals();
+}
+
+void BatchProcessor::printTotals()
+{
+    qreal seconds = m_timer.nsecsElapsed() / 1000000000.0;
+    qreal fps = seconds > 0.0 ? m_frames / seconds : 0.0;
+    std::cout << "sessions: " << m_sessions << " (" << m_failures << " failed), jobs: " << m_jobs << std::endl;
+    std::cout << "frames: " << m_frames << ", events: " << m_events << std::endl;
+    std::cout << "time: " << seconds << " s, " << fps << " frames/s, "
+              << fps / SENSOR_FPS << "x real time" << std::endl;
+    emit finished();
+}
@@ -0,0 +1,78 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Processes recorded sessions in parallel, one session per core at a time.
+
+    .oni recordings play through a full air cursor with OpenNI and NITE as
+    fast as they can be processed. .acd depth captures go through the grab
+    analysis only, with the hand points stored in the capture. Each session
+    has its own pipeline and event log, and a core is given the next session
+    as soon as its previous one finishes.
+*/
+
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include <QObject>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QList>
+
+#include "aircursor.h"
+
+class SessionLog;
+
+class BatchProcessor : public QObject
+{
+    Q_OBJECT
+public:
+    BatchProcessor(const QStringList& sessions, const QString& outputDir, QObject *parent = 0);
+
+    // settings for all sessions, set before start()
+    void setJobs(int jobs);
+    void setGrabParameters(const AirCursor::GrabParameters& parameters);
+    void setDepthFilters(AirCursor::DepthFilters filters);
+
+    void start();
+
+    // sessions that couldn't be processed
+    int failures() const { return m_failures; }
+
+signals:
+    void finished();
+
+private slots:
+    void sessionFinished();
+
+private:
+    struct Session
+    {
+        QString fileName;
+        QThread* thread;
+        AirCursor* cursor;
+        SessionLog* log;
+        QElapsedTimer timer;
+    };
+
+    void startNext();
+    bool startSession(Session& session);
+    void printTotals();
+
+    QStringList m_pending;
+    QList<Session> m_running;
+    QString m_outputDir;
+    int m_jobs;
+    AirCursor::GrabParameters m_grabParameters;
+    AirCursor::DepthFilters m_depthFilters;
+
+    QElapsedTimer m_timer;
+    int m_sessions;
+    int m_failures;
+    quint64 m_frames;
+    quint64 m_events;
+};
+
+#endif // BATCHPROCESSOR_H
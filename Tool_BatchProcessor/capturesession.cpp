@@ -0,0 +1,87 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Runs the grab analysis and gesture detection over a depth capture on its
+    own thread. Captures have the hand point NITE tracked when they were
+    recorded, so the frames go straight to AirCursor::processFrame() and the
+    hand points to a GestureDetector without OpenNI.
+*/
+
+#include <QVector>
+
+#include "capturesession.h"
+#include "sessionlog.h"
+#include "depthcapture.h"
+#include "gesturedetector.h"
+
+CaptureSession::CaptureSession(const QString& fileName, const AirCursor::GrabParameters& parameters,
+                               AirCursor::DepthFilters filters, SessionLog* log, QObject *parent) :
+    QThread(parent),
+    m_fileName(fileName),
+    m_parameters(parameters),
+    m_filters(filters),
+    m_log(log),
+    m_ok(false)
+{
+}
+
+void CaptureSession::run()
+{
+    DepthCapture capture;
+    if (!capture.open(m_fileName)) return;
+
+    // created here so that the pipeline belongs to this thread only
+    AirCursor ac;
+    ac.setGrabParameters(m_parameters);
+    ac.setDepthFilters(m_filters);
+    if (!ac.initProcessing(AirCursor::DebugNone, capture.width(), capture.height())) return;
+
+    // swipes and pushes from the raw hand points, like the native gesture engine
+    GestureDetector gestures;
+
+    QVector<XnDepthPixel> frame(capture.width() * capture.height());
+    XnUInt64 timestamp;
+    XnPoint3D hand;
+    bool hasHand;
+    bool tracking = false;
+    qreal time = 0.0;
+    while (capture.readFrame(frame.data(), timestamp, hand, hasHand))
+    {
+        time = timestamp / 1000000.0;
+        if (hasHand)
+        {
+            if (!tracking)
+            {
+                gestures.reset();
+                m_log->handCreate(hand.X, hand.Y, hand.Z, time);
+            }
+            tracking = true;
+
+            switch (gestures.addPoint(hand.X, hand.Y, hand.Z, time))
+            {
+                case GestureDetector::GestureSwipeUp: m_log->swipeUp(gestures.velocity(), gestures.angle()); break;
+                case GestureDetector::GestureSwipeDown: m_log->swipeDown(gestures.velocity(), gestures.angle()); break;
+                case GestureDetector::GestureSwipeLeft: m_log->swipeLeft(gestures.velocity(), gestures.angle()); break;
+                case GestureDetector::GestureSwipeRight: m_log->swipeRight(gestures.velocity(), gestures.angle()); break;
+                case GestureDetector::GesturePush: m_log->push(hand.X, hand.Y, hand.Z, gestures.velocity(), gestures.angle()); break;
+                default: break;
+            }
+
+            bool grabbing = ac.processFrame(frame.constData(), hand);
+            m_log->handUpdate(hand.X, hand.Y, hand.Z, time, grabbing);
+        }
+        else if (tracking)
+        {
+            m_log->handDestroy(time);
+            tracking = false;
+        }
+        m_log->addFrames(1);
+    }
+    if (tracking) m_log->handDestroy(time);
+
+    // reading stops at the end or at a corrupt frame
+    m_ok = capture.atEnd();
+}
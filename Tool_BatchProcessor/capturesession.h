@@ -0,0 +1,43 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Runs the grab analysis and gesture detection over a depth capture on its
+    own thread. Captures have the hand point NITE tracked when they were
+    recorded, so the frames go straight to AirCursor::processFrame() and the
+    hand points to a GestureDetector without OpenNI.
+*/
+
+#ifndef CAPTURESESSION_H
+#define CAPTURESESSION_H
+
+#include <QThread>
+
+#include "aircursor.h"
+
+class SessionLog;
+
+class CaptureSession : public QThread
+{
+    Q_OBJECT
+public:
+    CaptureSession(const QString& fileName, const AirCursor::GrabParameters& parameters,
+                   AirCursor::DepthFilters filters, SessionLog* log, QObject *parent = 0);
+
+    // false if the capture couldn't be read to the end
+    bool ok() const { return m_ok; }
+
+protected:
+    void run();
+
+private:
+    QString m_fileName;
+    AirCursor::GrabParameters m_parameters;
+    AirCursor::DepthFilters m_filters;
+    SessionLog* m_log;
+    bool m_ok;
+};
+
+#endif // CAPTURESESSION_H
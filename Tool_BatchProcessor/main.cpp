@@ -0,0 +1,90 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Processes a directory of recorded sessions offline.
+
+    BatchProcessor directory [--output dir] [--jobs n] [--smoothing a] [--threshold a] [--defect n] [--filter]
+        runs every .oni recording and .acd depth capture in the directory,
+        one session per core at a time, writes an event log for each session
+        and prints per-session and total throughput
+*/
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QDir>
+#include <iostream>
+
+#include "batchprocessor.h"
+
+static void usage()
+{
+    std::cout << "usage: BatchProcessor directory [--output dir] [--jobs n] [--smoothing a] [--threshold a] [--defect n] [--filter]" << std::endl;
+}
+
+// value following the option, or an empty string if the option is not given
+static QString optionValue(const QStringList& args, const QString& option)
+{
+    int index = args.indexOf(option);
+    if (index >= 0 && index + 1 < args.size()) return args.at(index + 1);
+    return QString();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    if (args.size() < 2 || args.at(1).startsWith("--"))
+    {
+        usage();
+        return 1;
+    }
+
+    QDir dir(args.at(1));
+    QStringList filters;
+    filters << "*.oni" << "*.acd";
+    QStringList sessions;
+    foreach (const QString& name, dir.entryList(filters, QDir::Files, QDir::Name))
+    {
+        sessions << dir.filePath(name);
+    }
+    if (sessions.isEmpty())
+    {
+        std::cout << "no sessions in " << args.at(1).toLocal8Bit().constData() << std::endl;
+        return 1;
+    }
+
+    QString output = optionValue(args, "--output");
+    if (output.isEmpty()) output = dir.filePath("logs");
+    if (!QDir().mkpath(output))
+    {
+        std::cout << "can't create " << output.toLocal8Bit().constData() << std::endl;
+        return 1;
+    }
+
+    AirCursor::GrabParameters parameters;
+    QString value = optionValue(args, "--smoothing");
+    if (!value.isEmpty()) parameters.smoothingFactor = value.toDouble();
+    value = optionValue(args, "--threshold");
+    if (!value.isEmpty()) parameters.stateChangeThreshold = value.toDouble();
+    value = optionValue(args, "--defect");
+    if (!value.isEmpty()) parameters.defectMinSize = value.toInt();
+
+    BatchProcessor processor(sessions, output);
+    processor.setGrabParameters(parameters);
+    value = optionValue(args, "--jobs");
+    if (!value.isEmpty()) processor.setJobs(value.toInt());
+    if (args.contains("--filter"))
+    {
+        processor.setDepthFilters(AirCursor::FilterHoleFill | AirCursor::FilterMedian | AirCursor::FilterMorphology);
+    }
+
+    // quit is queued, so the processor can finish before the event loop runs
+    QObject::connect(&processor, SIGNAL(finished()), &app, SLOT(quit()), Qt::QueuedConnection);
+    processor.start();
+    int result = app.exec();
+    return result == 0 && processor.failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Event log of one processed session. Slots are connected directly to the
+    air cursor signals and run on the tracker thread, so each session has
+    its own log and nothing is shared between sessions.
+
+    One event per line: time in seconds, event name and its values.
+*/
+
+#include <iostream>
+
+#include "sessionlog.h"
+
+SessionLog::SessionLog(QObject *parent) :
+    QObject(parent),
+    m_time(0.0),
+    m_grabbing(false),
+    m_events(0),
+    m_frames(0),
+    m_grabs(0)
+{
+}
+
+bool SessionLog::open(const QString& fileName)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        std::cout << "creating log " << fileName.toLocal8Bit().constData() << " failed" << std::endl;
+        return false;
+    }
+    m_stream.setDevice(&m_file);
+    return true;
+}
+
+void SessionLog::close()
+{
+    m_stream.flush();
+    m_file.close();
+}
+
+void SessionLog::connectTo(AirCursor* ac)
+{
+    connect(ac, SIGNAL(handCreate(qreal, qreal, qreal, qreal)), SLOT(handCreate(qreal, qreal, qreal, qreal)), Qt::DirectConnection);
+    connect(ac, SIGNAL(handDestroy(qreal)), SLOT(handDestroy(qreal)), Qt::DirectConnection);
+    connect(ac, SIGNAL(handLost(qreal)), SLOT(handLost(qreal)), Qt::DirectConnection);
+    connect(ac, SIGNAL(handRecovered(qreal, qreal, qreal, qreal)), SLOT(handRecovered(qreal, qreal, qreal, qreal)), Qt::DirectConnection);
+    connect(ac, SIGNAL(handUpdate(qreal, qreal, qreal, qreal, bool)), SLOT(handUpdate(qreal, qreal, qreal, qreal, bool)), Qt::DirectConnection);
+    connect(ac, SIGNAL(gestureRecognized(QString)), SLOT(gestureRecognized(QString)), Qt::DirectConnection);
+    connect(ac, SIGNAL(sessionStart()), SLOT(sessionStart()), Qt::DirectConnection);
+    connect(ac, SIGNAL(sessionEnd()), SLOT(sessionEnd()), Qt::DirectConnection);
+    connect(ac, SIGNAL(push(qreal, qreal, qreal, qreal, qreal)), SLOT(push(qreal, qreal, qreal, qreal, qreal)), Qt::DirectConnection);
+    connect(ac, SIGNAL(swipeUp(qreal, qreal)), SLOT(swipeUp(qreal, qreal)), Qt::DirectConnection);
+    connect(ac, SIGNAL(swipeDown(qreal, qreal)), SLOT(swipeDown(qreal, qreal)), Qt::DirectConnection);
+    connect(ac, SIGNAL(swipeLeft(qreal, qreal)), SLOT(swipeLeft(qreal, qreal)), Qt::DirectConnection);
+    connect(ac, SIGNAL(swipeRight(qreal, qreal)), SLOT(swipeRight(qreal, qreal)), Qt::DirectConnection);
+    connect(ac, SIGNAL(statisticsUpdate(AirCursorStatistics)), SLOT(statisticsUpdate(AirCursorStatistics)), Qt::DirectConnection);
+}
+
+void SessionLog::write(const QString& event, const QString& values)
+{
+    m_stream << QString::number(m_time, 'f', 3) << " " << event;
+    if (!values.isEmpty()) m_stream << " " << values;
+    m_stream << "\n";
+    m_events++;
+}
+
+void SessionLog::handCreate(qreal x, qreal y, qreal z, qreal time)
+{
+    m_time = time;
+    m_grabbing = false;
+    write("hand_create", QString("%1 %2 %3").arg(x).arg(y).arg(z));
+}
+
+void SessionLog::handDestroy(qreal time)
+{
+    m_time = time;
+    write("hand_destroy");
+}
+
+void SessionLog::handLost(qreal time)
+{
+    m_time = time;
+    write("hand_lost");
+}
+
+void SessionLog::handRecovered(qreal x, qreal y, qreal z, qreal time)
+{
+    m_time = time;
+    write("hand_recovered", QString("%1 %2 %3").arg(x).arg(y).arg(z));
+}
+
+void SessionLog::handUpdate(qreal x, qreal y, qreal z, qreal time, bool grab)
+{
+    m_time = time;
+    if (grab == m_grabbing) return;
+
+    m_grabbing = grab;
+    if (grab) m_grabs++;
+    write(grab ? "grab" : "release", QString("%1 %2 %3").arg(x).arg(y).arg(z));
+}
+
+void SessionLog::gestureRecognized(QString gesture)
+{
+    write("focus_gesture", gesture);
+}
+
+void SessionLog::sessionStart()
+{
+    write("session_start");
+}
+
+void SessionLog::sessionEnd()
+{
+    write("session_end");
+}
+
+void SessionLog::push(qreal x, qreal y, qreal z, qreal velocity, qreal angle)
+{
+    write("push", QString("%1 %2 %3 %4 %5").arg(x).arg(y).arg(z).arg(velocity).arg(angle));
+}
+
+void SessionLog::swipeUp(qreal velocity, qreal angle)
+{
+    write("swipe_up", QString("%1 %2").arg(velocity).arg(angle));
+}
+
+void SessionLog::swipeDown(qreal velocity, qreal angle)
+{
+    write("swipe_down", QString("%1 %2").arg(velocity).arg(angle));
+}
+
+void SessionLog::swipeLeft(qreal velocity, qreal angle)
+{
+    write("swipe_left", QString("%1 %2").arg(velocity).arg(angle));
+}
+
+void SessionLog::swipeRight(qreal velocity, qreal angle)
+{
+    write("swipe_right", QString("%1 %2").arg(velocity).arg(angle));
+}
+
+void SessionLog::statisticsUpdate(AirCursorStatistics statistics)
+{
+    addFrames(statistics.frames);
+}
@@ -0,0 +1,76 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Event log of one processed session. Slots are connected directly to the
+    air cursor signals and run on the tracker thread, so each session has
+    its own log and nothing is shared between sessions.
+
+    One event per line: time in seconds, event name and its values.
+*/
+
+#ifndef SESSIONLOG_H
+#define SESSIONLOG_H
+
+#include <QObject>
+#include <QFile>
+#include <QTextStream>
+
+#include "aircursor.h"
+
+class SessionLog : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SessionLog(QObject *parent = 0);
+
+    bool open(const QString& fileName);
+    void close();
+
+    // connects all event signals with direct connections
+    void connectTo(AirCursor* ac);
+
+    // depth frames processed, from the statistics or added by the caller
+    void addFrames(quint32 frames) { m_frames += frames; }
+
+    quint32 events() const { return m_events; }
+    quint32 frames() const { return m_frames; }
+    quint32 grabs() const { return m_grabs; }
+
+public slots:
+    void handCreate(qreal x, qreal y, qreal z, qreal time);
+    void handDestroy(qreal time);
+    void handLost(qreal time);
+    void handRecovered(qreal x, qreal y, qreal z, qreal time);
+
+    // grab and release are logged from changes of the grab flag so that they get the frame time
+    void handUpdate(qreal x, qreal y, qreal z, qreal time, bool grab);
+
+    void gestureRecognized(QString gesture);
+    void sessionStart();
+    void sessionEnd();
+    void push(qreal x, qreal y, qreal z, qreal velocity, qreal angle);
+    void swipeUp(qreal velocity, qreal angle);
+    void swipeDown(qreal velocity, qreal angle);
+    void swipeLeft(qreal velocity, qreal angle);
+    void swipeRight(qreal velocity, qreal angle);
+    void statisticsUpdate(AirCursorStatistics statistics);
+
+private:
+    void write(const QString& event, const QString& values = QString());
+
+    QFile m_file;
+    QTextStream m_stream;
+
+    // time of the latest hand update, for events that don't carry a time
+    qreal m_time;
+    bool m_grabbing;
+
+    quint32 m_events;
+    quint32 m_frames;
+    quint32 m_grabs;
+};
+
+#endif // SESSIONLOG_H
@@ -0,0 +1,53 @@
+QT       += core gui
+
+TARGET = Benchmark
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+
+SOURCES += main.cpp \
+        filterbenchmark.cpp \
+        grabbenchmark.cpp \
+        pipelinebenchmark.cpp \
+        kernelbenchmark.cpp \
+        codecbenchmark.cpp \
+        listenerbenchmark.cpp \
+        ../aircursor.cpp \
+        ../gesturedetector.cpp \
+        ../handtrajectory.cpp \
+        ../depthcodec.cpp \
+        ../depthcapture.cpp \
+        ../aircursorlistener.cpp \
+        ../synthetichand.cpp
+
+HEADERS += filterbenchmark.h \
+        grabbenchmark.h \
+        pipelinebenchmark.h \
+        kernelbenchmark.h \
+        codecbenchmark.h \
+        listenerbenchmark.h \
+        ../aircursorkernels.h \
+        ../aircursor.h \
+        ../gesturedetector.h \
+        ../handtrajectory.h \
+        ../depthprojection.h \
+        ../synthetichand.h \
+        ../depthcodec.h \
+        ../depthcapture.h \
+        ../aircursorlistener.h
+
+INCLUDEPATH += /usr/include/ni
+DEPENDPATH += /usr/include/ni
+
+INCLUDEPATH += /usr/include/nite
+DEPENDPATH += /usr/include/nite
+
+INCLUDEPATH += /usr/include/opencv
+DEPENDPATH += /usr/include/opencv
+
+INCLUDEPATH += ../
+DEPENDPATH += ../
+
+LIBS += -lOpenNI -lXnVNite_1_5_2 -lXnVHandGenerator_1_5_2
+LIBS += -lopencv_core -lopencv_imgproc
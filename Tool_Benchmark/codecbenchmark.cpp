@@ -0,0 +1,103 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Measures compression ratio and encode and decode speed of DepthCodec on
+    synthetic frames or on the frames of a depth capture, and checks that
+    every frame decodes back to the original.
+*/
+
+#include <QElapsedTimer>
+#include <qmath.h>
+
+#include "codecbenchmark.h"
+#include "depthcodec.h"
+#include "depthcapture.h"
+#include "synthetichand.h"
+
+// passes over the frames, the first one also checks decoding
+const int CODEC_PASSES = 3;
+
+// columns on the right edge without depth, like the Kinect's
+const int INVALID_COLUMNS = 8;
+
+void CodecBenchmark::generate(int frames, qreal depthNoise)
+{
+    SyntheticHand generator;
+    generator.setNoise(depthNoise, 0.2, 2.0);
+    m_width = generator.projection().xRes();
+    m_height = generator.projection().yRes();
+
+    m_frames.clear();
+    SyntheticHand::Pose pose;
+    for (int i = 0; i < frames; i++)
+    {
+        // hand circles slowly and opens and closes once a second
+        pose.position.X = 150.0 * qCos(i * 0.05);
+        pose.position.Y = 100.0 * qSin(i * 0.05);
+        pose.rotation = 0.3 * qSin(i * 0.02);
+        pose.fingers = (i / 15) % 2 ? 5 : 0;
+
+        QVector<XnDepthPixel> frame(m_width * m_height);
+        generator.render(pose, frame.data());
+        for (int y = 0; y < m_height; y++)
+        {
+            for (int x = m_width - INVALID_COLUMNS; x < m_width; x++) frame[y * m_width + x] = 0;
+        }
+        m_frames << frame;
+    }
+}
+
+bool CodecBenchmark::loadCapture(const QString& fileName)
+{
+    DepthCapture capture;
+    if (!capture.open(fileName)) return false;
+    m_width = capture.width();
+    m_height = capture.height();
+
+    m_frames.clear();
+    QVector<XnDepthPixel> frame(m_width * m_height);
+    XnUInt64 timestamp;
+    XnPoint3D hand;
+    bool hasHand;
+    while (capture.readFrame(frame.data(), timestamp, hand, hasHand)) m_frames << frame;
+    return !m_frames.isEmpty();
+}
+
+CodecBenchmark::Result CodecBenchmark::run()
+{
+    Result result;
+    if (m_frames.isEmpty()) return result;
+
+    QVector<uchar> encoded(DepthCodec::maxEncodedSize(m_width, m_height));
+    QVector<XnDepthPixel> decoded(m_width * m_height);
+    qint64 rawBytes = 0, encodedBytes = 0, encodeTime = 0, decodeTime = 0;
+    QElapsedTimer timer;
+
+    for (int pass = 0; pass < CODEC_PASSES; pass++)
+    {
+        foreach (const QVector<XnDepthPixel>& frame, m_frames)
+        {
+            timer.start();
+            int size = DepthCodec::encode(frame.constData(), m_width, m_height, encoded.data());
+            encodeTime += timer.nsecsElapsed();
+
+            timer.start();
+            bool ok = DepthCodec::decode(encoded.constData(), size, decoded.data(), m_width, m_height);
+            decodeTime += timer.nsecsElapsed();
+
+            if (pass == 0 && (!ok || decoded != frame)) result.lossless = false;
+            rawBytes += frame.size() * sizeof(XnDepthPixel);
+            encodedBytes += size;
+        }
+    }
+
+    int n = CODEC_PASSES * m_frames.size();
+    result.frames = m_frames.size();
+    result.ratio = (qreal)rawBytes / encodedBytes;
+    result.encodeTime = encodeTime / 1000000.0 / n;
+    result.decodeTime = decodeTime / 1000000.0 / n;
+    return result;
+}
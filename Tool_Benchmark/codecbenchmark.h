@@ -0,0 +1,55 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Measures compression ratio and encode and decode speed of DepthCodec on
+    synthetic frames or on the frames of a depth capture, and checks that
+    every frame decodes back to the original.
+*/
+
+#ifndef CODECBENCHMARK_H
+#define CODECBENCHMARK_H
+
+#include <QList>
+#include <QVector>
+#include <XnTypes.h>
+
+class CodecBenchmark
+{
+public:
+
+    struct Result
+    {
+        Result() : frames(0), ratio(0.0), encodeTime(0.0), decodeTime(0.0), lossless(true) {}
+
+        int frames;
+
+        // raw size per encoded size
+        qreal ratio;
+
+        // per frame in milliseconds
+        qreal encodeTime;
+        qreal decodeTime;
+
+        bool lossless;
+    };
+
+    // moving hand with depth noise of given deviation in mm at 1 m
+    void generate(int frames, qreal depthNoise);
+
+    bool loadCapture(const QString& fileName);
+
+    Result run();
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+private:
+    QList<QVector<XnDepthPixel> > m_frames;
+    int m_width;
+    int m_height;
+};
+
+#endif // CODECBENCHMARK_H
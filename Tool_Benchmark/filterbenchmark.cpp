@@ -0,0 +1,89 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Plays a recording through air cursor with different depth filters and
+    measures their cost and how much the grab state flickers.
+*/
+
+#include <QStringList>
+
+#include "filterbenchmark.h"
+
+// grab states shorter than this are counted as flicker, in seconds
+const qreal SHORT_STATE_DURATION = 0.3;
+
+// longer gaps between hand updates are a lost hand and not counted as tracked time
+const qreal MAX_UPDATE_GAP = 0.5;
+
+FilterBenchmark::FilterBenchmark(const QString& recording, QObject *parent) :
+    QObject(parent),
+    m_recording(recording)
+{
+}
+
+bool FilterBenchmark::run(AirCursor::DepthFilters filters, Result& result)
+{
+    m_result = Result();
+    m_lastTime = -1.0;
+    m_stateStart = -1.0;
+    m_grabbing = false;
+    m_analysisSum = m_filterSum = 0.0;
+
+    AirCursor ac;
+    ac.setRecording(m_recording, AirCursor::PlaybackFastest);
+    ac.setDepthFilters(filters);
+    if (!ac.init(AirCursor::DebugNone)) return false;
+
+    connect(&ac, SIGNAL(handUpdate(qreal, qreal, qreal, qreal, bool)), this, SLOT(handUpdate(qreal, qreal, qreal, qreal, bool)), Qt::DirectConnection);
+    connect(&ac, SIGNAL(statisticsUpdate(AirCursorStatistics)), this, SLOT(statisticsUpdate(AirCursorStatistics)), Qt::DirectConnection);
+
+    // thread ends at the end of the recording
+    ac.start();
+    ac.wait();
+
+    if (m_result.frames > 0)
+    {
+        m_result.grabAnalysisTime = m_analysisSum / m_result.frames;
+        m_result.depthFilterTime = m_filterSum / m_result.frames;
+    }
+    result = m_result;
+    return true;
+}
+
+QString FilterBenchmark::filterName(AirCursor::DepthFilters filters)
+{
+    if (filters == AirCursor::FilterNone) return "none";
+
+    QStringList names;
+    if (filters & AirCursor::FilterHoleFill) names << "holefill";
+    if (filters & AirCursor::FilterMedian) names << "median";
+    if (filters & AirCursor::FilterMorphology) names << "morphology";
+    return names.join("+");
+}
+
+void FilterBenchmark::handUpdate(qreal x, qreal y, qreal z, qreal time, bool grab)
+{
+    Q_UNUSED(x); Q_UNUSED(y); Q_UNUSED(z);
+
+    if (m_lastTime >= 0.0 && time - m_lastTime < MAX_UPDATE_GAP) m_result.trackedTime += time - m_lastTime;
+    m_lastTime = time;
+
+    if (m_stateStart < 0.0) m_stateStart = time;
+    if (grab != m_grabbing)
+    {
+        m_result.transitions++;
+        if (time - m_stateStart < SHORT_STATE_DURATION) m_result.shortStates++;
+        m_stateStart = time;
+        m_grabbing = grab;
+    }
+}
+
+void FilterBenchmark::statisticsUpdate(AirCursorStatistics statistics)
+{
+    m_result.frames += statistics.analyzedFrames;
+    m_analysisSum += statistics.grabAnalysisTime * statistics.analyzedFrames;
+    m_filterSum += statistics.depthFilterTime * statistics.analyzedFrames;
+}
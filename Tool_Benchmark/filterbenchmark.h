@@ -0,0 +1,62 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Plays a recording through air cursor with different depth filters and
+    measures their cost and how much the grab state flickers.
+*/
+
+#ifndef FILTERBENCHMARK_H
+#define FILTERBENCHMARK_H
+
+#include <QObject>
+#include <QString>
+
+#include "aircursor.h"
+
+class FilterBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+
+    struct Result
+    {
+        Result() : frames(0), trackedTime(0.0), transitions(0), shortStates(0),
+            grabAnalysisTime(0.0), depthFilterTime(0.0) {}
+
+        quint32 frames;
+        qreal trackedTime;
+        quint32 transitions;
+        quint32 shortStates;
+        qreal grabAnalysisTime;
+        qreal depthFilterTime;
+    };
+
+    explicit FilterBenchmark(const QString& recording, QObject *parent = 0);
+
+    // plays the whole recording once with given filters, false if air cursor init fails
+    bool run(AirCursor::DepthFilters filters, Result& result);
+
+    static QString filterName(AirCursor::DepthFilters filters);
+
+private slots:
+
+    // called directly from the tracker thread
+    void handUpdate(qreal x, qreal y, qreal z, qreal time, bool grab);
+    void statisticsUpdate(AirCursorStatistics statistics);
+
+private:
+
+    QString m_recording;
+    Result m_result;
+
+    qreal m_lastTime;
+    qreal m_stateStart;
+    bool m_grabbing;
+    qreal m_analysisSum;
+    qreal m_filterSum;
+};
+
+#endif // FILTERBENCHMARK_H
@@ -0,0 +1,197 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Runs labelled recordings through grab detection and compares detected
+    grab state against ground truth.
+
+    Label file has one closed hand interval per line as start and end times
+    in seconds, same times handUpdate() gives. Hand is open outside the
+    intervals. Lines starting with # are comments.
+*/
+
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QRegExp>
+#include <QThread>
+#include <iostream>
+
+#include "grabbenchmark.h"
+
+// longer gaps between hand updates are a lost hand and not counted as tracked time
+const qreal MAX_UPDATE_GAP = 0.5;
+
+bool GrabLabels::load(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        std::cout << "opening labels " << fileName.toLocal8Bit().constData() << " failed" << std::endl;
+        return false;
+    }
+
+    m_closed.clear();
+    QTextStream stream(&file);
+    int lineNumber = 0;
+    while (!stream.atEnd())
+    {
+        QString line = stream.readLine().trimmed();
+        lineNumber++;
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        QStringList fields = line.split(QRegExp("\\s+"));
+        bool startOk = false, endOk = false;
+        qreal start = fields.value(0).toDouble(&startOk);
+        qreal end = fields.value(1).toDouble(&endOk);
+        if (!startOk || !endOk || end < start)
+        {
+            std::cout << "invalid label on line " << lineNumber << std::endl;
+            return false;
+        }
+        m_closed << qMakePair(start, end);
+    }
+    return true;
+}
+
+bool GrabLabels::closedAt(qreal time) const
+{
+    for (int i = 0; i < m_closed.size(); i++)
+    {
+        if (time >= m_closed.at(i).first && time < m_closed.at(i).second) return true;
+    }
+    return false;
+}
+
+GrabEvaluator::GrabEvaluator(const GrabLabels& labels, QObject *parent) :
+    QObject(parent),
+    m_labels(labels),
+    m_analysisSum(0.0),
+    m_lastTime(-1.0),
+    m_grabbing(false),
+    m_labelClosed(false),
+    m_pending(false),
+    m_framesSinceEdge(0)
+{
+}
+
+GrabEvaluator::Result GrabEvaluator::result() const
+{
+    Result result = m_result;
+    if (m_pending) result.missed++;
+    if (result.frames > 0) result.grabAnalysisTime = m_analysisSum / result.frames;
+    return result;
+}
+
+void GrabEvaluator::handUpdate(qreal x, qreal y, qreal z, qreal time, bool grab)
+{
+    Q_UNUSED(x); Q_UNUSED(y); Q_UNUSED(z);
+
+    bool closed = m_labels.closedAt(time);
+
+    // first update only sets the initial states
+    if (m_lastTime < 0.0)
+    {
+        m_lastTime = time;
+        m_grabbing = grab;
+        m_labelClosed = closed;
+        return;
+    }
+
+    if (time - m_lastTime < MAX_UPDATE_GAP) m_result.trackedTime += time - m_lastTime;
+    m_lastTime = time;
+
+    if (closed != m_labelClosed)
+    {
+        if (m_pending) m_result.missed++;
+        m_pending = true;
+        m_framesSinceEdge = 0;
+        m_labelClosed = closed;
+    }
+
+    if (grab != m_grabbing)
+    {
+        if (m_pending && grab == closed)
+        {
+            if (grab)
+            {
+                m_result.grabs++;
+                m_result.grabFrames += m_framesSinceEdge;
+            }
+            else
+            {
+                m_result.releases++;
+                m_result.releaseFrames += m_framesSinceEdge;
+            }
+            m_pending = false;
+        }
+        else
+        {
+            m_result.falseTransitions++;
+        }
+        m_grabbing = grab;
+    }
+
+    m_framesSinceEdge++;
+}
+
+void GrabEvaluator::statisticsUpdate(AirCursorStatistics statistics)
+{
+    m_result.frames += statistics.analyzedFrames;
+    m_analysisSum += statistics.grabAnalysisTime * statistics.analyzedFrames;
+}
+
+GrabBenchmark::GrabBenchmark(const QString& recording, const GrabLabels& labels) :
+    m_recording(recording),
+    m_labels(labels)
+{
+}
+
+bool GrabBenchmark::run(const QList<AirCursor::GrabParameters>& parameters, QList<GrabEvaluator::Result>& results)
+{
+    int threads = qMax(1, QThread::idealThreadCount());
+    results.clear();
+
+    // one batch of air cursors per core count, each plays the recording on its own
+    for (int first = 0; first < parameters.size(); first += threads)
+    {
+        int count = qMin(threads, parameters.size() - first);
+        QList<AirCursor*> cursors;
+        QList<GrabEvaluator*> evaluators;
+        bool ok = true;
+
+        for (int i = 0; i < count; i++)
+        {
+            AirCursor* ac = new AirCursor;
+            GrabEvaluator* evaluator = new GrabEvaluator(m_labels);
+            cursors << ac;
+            evaluators << evaluator;
+
+            ac->setRecording(m_recording, AirCursor::PlaybackFastest);
+            ac->setGrabParameters(parameters.at(first + i));
+            ac->setCpuAffinity(QList<int>() << i);
+            if (!ac->init(AirCursor::DebugNone))
+            {
+                ok = false;
+                break;
+            }
+
+            QObject::connect(ac, SIGNAL(handUpdate(qreal, qreal, qreal, qreal, bool)), evaluator, SLOT(handUpdate(qreal, qreal, qreal, qreal, bool)), Qt::DirectConnection);
+            QObject::connect(ac, SIGNAL(statisticsUpdate(AirCursorStatistics)), evaluator, SLOT(statisticsUpdate(AirCursorStatistics)), Qt::DirectConnection);
+        }
+
+        if (ok)
+        {
+            foreach (AirCursor* ac, cursors) ac->start();
+            foreach (AirCursor* ac, cursors) ac->wait();
+            foreach (GrabEvaluator* evaluator, evaluators) results << evaluator->result();
+        }
+
+        qDeleteAll(cursors);
+        qDeleteAll(evaluators);
+        if (!ok) return false;
+    }
+    return true;
+}
@@ -0,0 +1,100 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Runs labelled recordings through grab detection and compares detected
+    grab state against ground truth.
+
+    Label file has one closed hand interval per line as start and end times
+    in seconds, same times handUpdate() gives. Hand is open outside the
+    intervals. Lines starting with # are comments.
+*/
+
+#ifndef GRABBENCHMARK_H
+#define GRABBENCHMARK_H
+
+#include <QObject>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+#include "aircursor.h"
+
+class GrabLabels
+{
+public:
+    bool load(const QString& fileName);
+    bool closedAt(qreal time) const;
+
+private:
+    QList<QPair<qreal, qreal> > m_closed;
+};
+
+// collects accuracy and latency of one air cursor run against the labels
+class GrabEvaluator : public QObject
+{
+    Q_OBJECT
+public:
+
+    struct Result
+    {
+        Result() : frames(0), trackedTime(0.0), grabs(0), grabFrames(0), releases(0), releaseFrames(0),
+            missed(0), falseTransitions(0), grabAnalysisTime(0.0) {}
+
+        quint32 frames;
+        qreal trackedTime;
+
+        // detected label edges and frames from the edge to detection summed
+        quint32 grabs;
+        quint32 grabFrames;
+        quint32 releases;
+        quint32 releaseFrames;
+
+        // label edges not detected before the next edge
+        quint32 missed;
+
+        // transitions that don't detect a label edge
+        quint32 falseTransitions;
+
+        qreal grabAnalysisTime;
+    };
+
+    explicit GrabEvaluator(const GrabLabels& labels, QObject *parent = 0);
+
+    Result result() const;
+
+private slots:
+
+    // called directly from the tracker thread
+    void handUpdate(qreal x, qreal y, qreal z, qreal time, bool grab);
+    void statisticsUpdate(AirCursorStatistics statistics);
+
+private:
+
+    const GrabLabels& m_labels;
+    Result m_result;
+    qreal m_analysisSum;
+
+    qreal m_lastTime;
+    bool m_grabbing;
+    bool m_labelClosed;
+    bool m_pending;
+    quint32 m_framesSinceEdge;
+};
+
+// runs parameter sets in parallel, each on its own air cursor thread and core
+class GrabBenchmark
+{
+public:
+    GrabBenchmark(const QString& recording, const GrabLabels& labels);
+
+    bool run(const QList<AirCursor::GrabParameters>& parameters, QList<GrabEvaluator::Result>& results);
+
+private:
+    QString m_recording;
+    const GrabLabels& m_labels;
+};
+
+#endif // GRABBENCHMARK_H
@@ -0,0 +1,323 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Times each step of the grab analysis separately on generated hand frames
+    of different sizes and finger counts. Results can be saved and used as a
+    baseline for a later run to see the effect of a change.
+*/
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+#include <iostream>
+
+#include "kernelbenchmark.h"
+#include "aircursorkernels.h"
+#include "synthetichand.h"
+
+// iterations per measurement for frame kernels and for per point kernels
+const int FRAME_ITERATIONS = 200;
+const int SCALAR_ITERATIONS = 1000000;
+
+// keeps the compiler from dropping benchmarked calls whose results are unused
+static volatile qreal sink;
+
+// hand at the frame center rendered at given resolution, returns the hand point
+static XnPoint3D renderHand(QVector<XnDepthPixel>& frame, int width, int height, int distance, int fingers)
+{
+    DepthProjection projection;
+    projection.setResolution(width, height);
+    SyntheticHand generator(projection);
+
+    SyntheticHand::Pose pose;
+    pose.position.Z = distance;
+    pose.fingers = fingers;
+    frame.resize(width * height);
+    return generator.render(pose, frame.data());
+}
+
+void KernelBenchmark::run()
+{
+    m_results.clear();
+
+    const int sizes[][2] = { {320, 240}, {640, 480}, {1280, 960} };
+    for (int i = 0; i < 3; i++)
+    {
+        int width = sizes[i][0], height = sizes[i][1];
+        benchmarkFrame(width, height);
+
+        // near and far hand in mm
+        const int distances[] = { 600, 1200 };
+        const int fingerCounts[] = { 0, 2, 5 };
+        for (int d = 0; d < 2; d++)
+        {
+            for (int f = 0; f < 3; f++) benchmarkHand(width, height, distances[d], fingerCounts[f]);
+        }
+    }
+
+    benchmarkRender();
+    benchmarkScalar();
+}
+
+// depth conversion of the whole frame
+void KernelBenchmark::benchmarkFrame(int width, int height)
+{
+    QVector<XnDepthPixel> depth;
+    renderHand(depth, width, height, 900, 5);
+    IplImage* image = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 1);
+    CvRect roi = cvRect(width / 4, height / 4, width / 2, height / 2);
+    QString input = QString("%1x%2").arg(width).arg(height);
+
+    int histogram[256];
+    QElapsedTimer timer;
+
+    DynamicGeometry dynamic(width, height, image->widthStep);
+    timer.start();
+    for (int i = 0; i < FRAME_ITERATIONS; i++)
+    {
+        memset(histogram, 0, sizeof(histogram));
+        convertDepth(dynamic, depth.constData(), (unsigned char*)image->imageData, roi, histogram);
+    }
+    add("convert", input, (qreal)timer.nsecsElapsed() / FRAME_ITERATIONS, width * height);
+
+    if (FixedGeometry<640, 480>::matches(width, height, image->widthStep))
+    {
+        FixedGeometry<640, 480> fixed(width, height, image->widthStep);
+        timer.start();
+        for (int i = 0; i < FRAME_ITERATIONS; i++)
+        {
+            memset(histogram, 0, sizeof(histogram));
+            convertDepth(fixed, depth.constData(), (unsigned char*)image->imageData, roi, histogram);
+        }
+        add("convert_fixed", input, (qreal)timer.nsecsElapsed() / FRAME_ITERATIONS, width * height);
+    }
+
+    cvReleaseImage(&image);
+}
+
+// thresholding, contours and hull with defects in the hand region of interest
+void KernelBenchmark::benchmarkHand(int width, int height, int distance, int fingers)
+{
+    QVector<XnDepthPixel> depth;
+    XnPoint3D handPoint = renderHand(depth, width, height, distance, fingers);
+    QString input = QString("%1x%2/d%3/f%4").arg(width).arg(height).arg(distance).arg(fingers);
+
+    // region of interest around the hand like the tracker uses, bit more space above for fingers.
+    // palm radius in pixels from its size in mm
+    DepthProjection projection;
+    projection.setResolution(width, height);
+    XnPoint3D edge = handPoint;
+    edge.X += 45.0f;
+    int radius = qRound(projection.toProjective(edge).X - projection.toProjective(handPoint).X);
+    int left = qMax(0, width / 2 - radius * 2), top = qMax(0, height / 2 - radius * 3);
+    int right = qMin(width, width / 2 + radius * 2), bottom = qMin(height, height / 2 + radius * 2);
+    CvRect roi = cvRect(left, top, right - left, bottom - top);
+    int roiPixels = roi.width * roi.height;
+
+    IplImage* image = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 1);
+    IplImage* mask = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 1);
+    IplImage* work = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 1);
+    CvMemStorage* contourStorage = cvCreateMemStorage(0);
+    CvMemStorage* hullStorage = cvCreateMemStorage(0);
+
+    int histogram[256];
+    memset(histogram, 0, sizeof(histogram));
+    DynamicGeometry g(width, height, image->widthStep);
+    convertDepth(g, depth.constData(), (unsigned char*)image->imageData, roi, histogram);
+    int lowerBound = qMax(0, handDepthPixel(histogram, depthToPixel(handPoint.Z)) - DEPTH_THRESHOLD);
+
+    cvSetImageROI(image, roi);
+    cvSetImageROI(mask, roi);
+    cvSetImageROI(work, roi);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < FRAME_ITERATIONS; i++)
+    {
+        cvThreshold(image, mask, lowerBound, 255, CV_THRESH_BINARY);
+    }
+    add("threshold", input, (qreal)timer.nsecsElapsed() / FRAME_ITERATIONS, roiPixels);
+
+    // contour finding modifies its input, copies are left out of the time
+    qint64 contourTime = 0;
+    CvSeq* contours = 0;
+    for (int i = 0; i < FRAME_ITERATIONS; i++)
+    {
+        cvCopy(mask, work);
+        timer.start();
+        cvClearMemStorage(contourStorage);
+        contours = 0;
+        cvFindContours(work, contourStorage, &contours, sizeof(CvContour));
+        contourTime += timer.nsecsElapsed();
+    }
+    add("contours", input, (qreal)contourTime / FRAME_ITERATIONS, roiPixels);
+
+    CvSeq* biggest = 0;
+    double biggestArea = 0.0;
+    for (CvSeq* c = contours; c != 0; c = c->h_next)
+    {
+        double area = cvContourArea(c);
+        if (!biggest || area > biggestArea)
+        {
+            biggest = c;
+            biggestArea = area;
+        }
+    }
+
+    if (biggest)
+    {
+        int defectCount = 0;
+        timer.start();
+        for (int i = 0; i < FRAME_ITERATIONS; i++)
+        {
+            cvClearMemStorage(hullStorage);
+            CvSeq* hull = cvConvexHull2(biggest, hullStorage, CV_CLOCKWISE, 0);
+            CvSeq* defects = cvConvexityDefects(biggest, hull, hullStorage);
+            defectCount += defects->total;
+        }
+        add("hull_defects", input, (qreal)timer.nsecsElapsed() / FRAME_ITERATIONS, 0);
+        sink = defectCount;
+    }
+
+    cvReleaseMemStorage(&hullStorage);
+    cvReleaseMemStorage(&contourStorage);
+    cvReleaseImage(&work);
+    cvReleaseImage(&mask);
+    cvReleaseImage(&image);
+}
+
+// synthetic frames themselves, with noise and dropouts, so it's known how much
+// of a load test goes to generating the input
+void KernelBenchmark::benchmarkRender()
+{
+    const int sizes[][2] = { {320, 240}, {640, 480}, {1280, 960} };
+    for (int i = 0; i < 3; i++)
+    {
+        int width = sizes[i][0], height = sizes[i][1];
+        DepthProjection projection;
+        projection.setResolution(width, height);
+        SyntheticHand generator(projection);
+        generator.setNoise(1.5, 0.2, 2.0);
+
+        QVector<XnDepthPixel> frame(width * height);
+        SyntheticHand::Pose pose;
+        QElapsedTimer timer;
+        timer.start();
+        for (int j = 0; j < FRAME_ITERATIONS; j++)
+        {
+            pose.rotation = 0.01 * j;
+            pose.fingers = (j / 15) % 6;
+            generator.render(pose, frame.data());
+        }
+        add("render", QString("%1x%2").arg(width).arg(height), (qreal)timer.nsecsElapsed() / FRAME_ITERATIONS, width * height);
+    }
+}
+
+// per frame bookkeeping that doesn't touch pixels
+void KernelBenchmark::benchmarkScalar()
+{
+    QElapsedTimer timer;
+
+    QList<XnPoint3D> points;
+    XnPoint3D point;
+    point.X = point.Y = 0; point.Z = 900;
+    qreal sum = 0.0;
+    timer.start();
+    for (int i = 0; i < SCALAR_ITERATIONS; i++)
+    {
+        point.X = i & 63;
+        sum += smoothHandPoint(points, point, 5).X;
+    }
+    add("smoothing", "5 points", (qreal)timer.nsecsElapsed() / SCALAR_ITERATIONS, 0);
+    sink = sum;
+
+    // hand opens and closes every 16 frames so that state changes happen
+    qreal runningGrab = 0.0;
+    bool grabbing = false;
+    int changes = 0;
+    timer.start();
+    for (int i = 0; i < SCALAR_ITERATIONS; i++)
+    {
+        changes += updateGrabState(runningGrab, grabbing, (i >> 4) & 1, 0.5, 0.1);
+    }
+    add("update_state", "alternating", (qreal)timer.nsecsElapsed() / SCALAR_ITERATIONS, 0);
+    sink = changes;
+}
+
+void KernelBenchmark::add(const QString& kernel, const QString& input, qreal nsPerFrame, int pixels)
+{
+    Result result;
+    result.kernel = kernel;
+    result.input = input;
+    result.nsPerFrame = nsPerFrame;
+    result.nsPerPixel = pixels > 0 ? nsPerFrame / pixels : 0.0;
+    m_results << result;
+}
+
+bool KernelBenchmark::save(const QString& fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        std::cout << "opening " << fileName.toLocal8Bit().constData() << " for writing failed" << std::endl;
+        return false;
+    }
+
+    QTextStream stream(&file);
+    foreach (const Result& result, m_results)
+    {
+        stream << result.kernel << " " << QString(result.input).replace(' ', '_') << " " << result.nsPerFrame << "\n";
+    }
+    return true;
+}
+
+bool KernelBenchmark::loadBaseline(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        std::cout << "opening baseline " << fileName.toLocal8Bit().constData() << " failed" << std::endl;
+        return false;
+    }
+
+    m_baseline.clear();
+    QTextStream stream(&file);
+    while (!stream.atEnd())
+    {
+        QStringList fields = stream.readLine().split(' ', QString::SkipEmptyParts);
+        if (fields.size() != 3) continue;
+        m_baseline.insert(fields.at(0) + " " + fields.at(1), fields.at(2).toDouble());
+    }
+    return true;
+}
+
+void KernelBenchmark::print() const
+{
+    std::cout << "kernel input ns_frame ns_pixel baseline_ns_frame change_%" << std::endl;
+    foreach (const Result& result, m_results)
+    {
+        QString input = QString(result.input).replace(' ', '_');
+        std::cout << result.kernel.toLocal8Bit().constData() << " "
+                  << input.toLocal8Bit().constData() << " "
+                  << result.nsPerFrame << " ";
+        if (result.nsPerPixel > 0.0) std::cout << result.nsPerPixel;
+        else std::cout << "-";
+
+        QString key = result.kernel + " " + input;
+        if (m_baseline.contains(key) && m_baseline.value(key) > 0.0)
+        {
+            qreal baseline = m_baseline.value(key);
+            std::cout << " " << baseline << " " << (result.nsPerFrame - baseline) / baseline * 100.0;
+        }
+        else
+        {
+            std::cout << " - -";
+        }
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,52 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Times each step of the grab analysis separately on generated hand frames
+    of different sizes and finger counts. Results can be saved and used as a
+    baseline for a later run to see the effect of a change.
+*/
+
+#ifndef KERNELBENCHMARK_H
+#define KERNELBENCHMARK_H
+
+#include <QList>
+#include <QMap>
+#include <QString>
+
+class KernelBenchmark
+{
+public:
+
+    struct Result
+    {
+        QString kernel;
+        QString input;
+        qreal nsPerFrame;
+
+        // 0 for kernels that don't work on pixels
+        qreal nsPerPixel;
+    };
+
+    void run();
+
+    bool save(const QString& fileName) const;
+    bool loadBaseline(const QString& fileName);
+    void print() const;
+
+private:
+    void benchmarkFrame(int width, int height);
+    void benchmarkHand(int width, int height, int distance, int fingers);
+    void benchmarkRender();
+    void benchmarkScalar();
+    void add(const QString& kernel, const QString& input, qreal nsPerFrame, int pixels);
+
+    QList<Result> m_results;
+
+    // ns per frame of a previous run by kernel and input
+    QMap<QString, qreal> m_baseline;
+};
+
+#endif // KERNELBENCHMARK_H
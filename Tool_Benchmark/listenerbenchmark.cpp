@@ -0,0 +1,93 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Measures the cost of delivering one hand update event to a direct listener
+    and through air cursor's Qt signals to a receiver in the same thread and
+    in another thread.
+*/
+
+#include <QThread>
+#include <QElapsedTimer>
+
+#include "listenerbenchmark.h"
+
+void EventCounter::handUpdate(const AirCursorHandFrame& frame)
+{
+    Q_UNUSED(frame);
+    m_events.fetchAndAddOrdered(1);
+}
+
+void EventCounter::handUpdate(qreal x, qreal y, qreal z, qreal time, bool grab)
+{
+    Q_UNUSED(x); Q_UNUSED(y); Q_UNUSED(z); Q_UNUSED(time); Q_UNUSED(grab);
+    m_events.fetchAndAddOrdered(1);
+}
+
+ListenerBenchmark::Result ListenerBenchmark::run(Receiver receiver, int events)
+{
+    // events are delivered the way the tracker thread delivers them, through a listener
+    // list that has the air cursor's signal listener
+    AirCursor ac;
+    AirCursorListenerList listeners;
+    EventCounter counter;
+    QThread receiverThread;
+
+    switch (receiver)
+    {
+        case ReceiverListener:
+            listeners.add(&counter);
+            break;
+        case ReceiverNone:
+            listeners.add(ac.signalListener());
+            break;
+        case ReceiverDirectConnection:
+            listeners.add(ac.signalListener());
+            QObject::connect(&ac, SIGNAL(handUpdate(qreal, qreal, qreal, qreal, bool)),
+                             &counter, SLOT(handUpdate(qreal, qreal, qreal, qreal, bool)), Qt::DirectConnection);
+            break;
+        case ReceiverQueuedConnection:
+            listeners.add(ac.signalListener());
+            counter.moveToThread(&receiverThread);
+            receiverThread.start();
+            QObject::connect(&ac, SIGNAL(handUpdate(qreal, qreal, qreal, qreal, bool)),
+                             &counter, SLOT(handUpdate(qreal, qreal, qreal, qreal, bool)), Qt::QueuedConnection);
+            break;
+    }
+
+    AirCursorHandFrame frame;
+    frame.handId = 1;
+    frame.z = 900.0;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < events; i++)
+    {
+        frame.x = i % 200;
+        frame.time = i / 30.0;
+        frame.grabbing = (i / 15) % 2;
+        listeners.handUpdate(frame);
+    }
+    qint64 emitTime = timer.nsecsElapsed();
+
+    // queued events are still on their way to the receiver thread
+    if (receiver == ReceiverQueuedConnection)
+    {
+        while (counter.events() < events) QThread::yieldCurrentThread();
+    }
+    qint64 deliveryTime = timer.nsecsElapsed();
+
+    Result result;
+    result.emitTime = (qreal)emitTime / events;
+    result.deliveryTime = (qreal)deliveryTime / events;
+    result.delivered = counter.events();
+
+    if (receiver == ReceiverQueuedConnection)
+    {
+        receiverThread.quit();
+        receiverThread.wait();
+    }
+    return result;
+}
@@ -0,0 +1,64 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Measures the cost of delivering one hand update event to a direct listener
+    and through air cursor's Qt signals to a receiver in the same thread and
+    in another thread.
+*/
+
+#ifndef LISTENERBENCHMARK_H
+#define LISTENERBENCHMARK_H
+
+#include <QObject>
+#include <QAtomicInt>
+
+#include "aircursor.h"
+
+// receives hand updates as a direct listener and as a Qt slot
+class EventCounter : public QObject, public AirCursorListener
+{
+    Q_OBJECT
+public:
+    EventCounter() : m_events(0) {}
+
+    void handUpdate(const AirCursorHandFrame& frame);
+    int events() const { return m_events.fetchAndAddOrdered(0); }
+
+public slots:
+    void handUpdate(qreal x, qreal y, qreal z, qreal time, bool grab);
+
+private:
+    mutable QAtomicInt m_events;
+};
+
+class ListenerBenchmark
+{
+public:
+
+    enum Receiver
+    {
+        ReceiverListener,           // direct listener
+        ReceiverNone,               // signals only, nothing connected
+        ReceiverDirectConnection,   // slot called on the tracker thread
+        ReceiverQueuedConnection    // slot called on another thread's event loop
+    };
+
+    struct Result
+    {
+        Result() : emitTime(0.0), deliveryTime(0.0), delivered(0) {}
+
+        // per event in nanoseconds, on the tracker thread and until the receiver has
+        // handled all events
+        qreal emitTime;
+        qreal deliveryTime;
+
+        int delivered;
+    };
+
+    Result run(Receiver receiver, int events);
+};
+
+#endif // LISTENERBENCHMARK_H
@@ -0,0 +1,300 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Command line benchmarks for air cursor.
+
+    --filter recording.oni
+        plays the recording with each depth filter combination and prints
+        grab analysis cost and grab state flicker
+
+    --grab recording.oni labels.txt [--smoothing a,b,...] [--threshold a,b,...] [--defect a,b,...]
+        runs the labelled recording with every combination of the given grab
+        parameters in parallel and prints detection latency and false transitions
+
+    --pipeline [frames]
+        analyzes synthetic frames with the specialized and the generic grab
+        analysis pipeline, with and without debug output, and prints the times
+
+    --kernels [--save results.txt] [--baseline results.txt]
+        times each grab analysis step on generated frames and prints the time
+        per frame and per pixel, compared to a saved baseline if one is given
+
+    --codec [capture.acd]
+        compresses synthetic frames at several noise levels, or the frames of
+        a depth capture, and prints compression ratio and encode and decode speed
+
+    --listeners [events]
+        delivers hand updates to a direct listener and through the Qt signals
+        with direct and queued connections and prints the cost per event
+*/
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <iostream>
+
+#include "filterbenchmark.h"
+#include "grabbenchmark.h"
+#include "pipelinebenchmark.h"
+#include "kernelbenchmark.h"
+#include "codecbenchmark.h"
+#include "listenerbenchmark.h"
+
+const int PIPELINE_FRAMES = 3000;
+const int CODEC_FRAMES = 300;
+const int LISTENER_EVENTS = 1000000;
+
+static void usage()
+{
+    std::cout << "usage: Benchmark --filter recording.oni" << std::endl;
+    std::cout << "       Benchmark --grab recording.oni labels.txt [--smoothing a,b,...] [--threshold a,b,...] [--defect a,b,...]" << std::endl;
+    std::cout << "       Benchmark --pipeline [frames]" << std::endl;
+    std::cout << "       Benchmark --kernels [--save results.txt] [--baseline results.txt]" << std::endl;
+    std::cout << "       Benchmark --codec [capture.acd]" << std::endl;
+    std::cout << "       Benchmark --listeners [events]" << std::endl;
+}
+
+// comma separated values following the option, or the default if the option is not given
+static QList<qreal> sweepValues(const QStringList& args, const QString& option, qreal defaultValue)
+{
+    QList<qreal> values;
+    int index = args.indexOf(option);
+    if (index >= 0 && index + 1 < args.size())
+    {
+        foreach (const QString& value, args.at(index + 1).split(',', QString::SkipEmptyParts))
+        {
+            values << value.toDouble();
+        }
+    }
+    if (values.isEmpty()) values << defaultValue;
+    return values;
+}
+
+static int filterBenchmark(const QString& recording)
+{
+    QList<AirCursor::DepthFilters> configurations;
+    configurations << AirCursor::FilterNone
+                   << AirCursor::FilterHoleFill
+                   << AirCursor::FilterMedian
+                   << AirCursor::FilterMorphology
+                   << (AirCursor::FilterHoleFill | AirCursor::FilterMedian | AirCursor::FilterMorphology);
+
+    FilterBenchmark benchmark(recording);
+
+    std::cout << "filters frames tracked_s transitions_per_min short_states analysis_ms filter_ms" << std::endl;
+    foreach (AirCursor::DepthFilters filters, configurations)
+    {
+        FilterBenchmark::Result result;
+        if (!benchmark.run(filters, result)) return 1;
+
+        qreal minutes = result.trackedTime / 60.0;
+        std::cout << FilterBenchmark::filterName(filters).toLocal8Bit().constData() << " "
+                  << result.frames << " "
+                  << result.trackedTime << " "
+                  << (minutes > 0.0 ? result.transitions / minutes : 0.0) << " "
+                  << result.shortStates << " "
+                  << result.grabAnalysisTime << " "
+                  << result.depthFilterTime << std::endl;
+    }
+    return 0;
+}
+
+static int grabBenchmark(const QString& recording, const QString& labelFile, const QStringList& args)
+{
+    GrabLabels labels;
+    if (!labels.load(labelFile)) return 1;
+
+    AirCursor::GrabParameters defaults;
+    QList<AirCursor::GrabParameters> parameters;
+    foreach (qreal smoothing, sweepValues(args, "--smoothing", defaults.smoothingFactor))
+    {
+        foreach (qreal threshold, sweepValues(args, "--threshold", defaults.stateChangeThreshold))
+        {
+            foreach (qreal defect, sweepValues(args, "--defect", defaults.defectMinSize))
+            {
+                AirCursor::GrabParameters p;
+                p.smoothingFactor = smoothing;
+                p.stateChangeThreshold = threshold;
+                p.defectMinSize = qRound(defect);
+                parameters << p;
+            }
+        }
+    }
+
+    GrabBenchmark benchmark(recording, labels);
+    QList<GrabEvaluator::Result> results;
+    if (!benchmark.run(parameters, results)) return 1;
+
+    std::cout << "smoothing threshold defect frames grab_frames release_frames missed false_per_min analysis_ms" << std::endl;
+    for (int i = 0; i < results.size(); i++)
+    {
+        const AirCursor::GrabParameters& p = parameters.at(i);
+        const GrabEvaluator::Result& r = results.at(i);
+        qreal minutes = r.trackedTime / 60.0;
+        std::cout << p.smoothingFactor << " " << p.stateChangeThreshold << " " << p.defectMinSize << " "
+                  << r.frames << " "
+                  << (r.grabs > 0 ? (qreal)r.grabFrames / r.grabs : 0.0) << " "
+                  << (r.releases > 0 ? (qreal)r.releaseFrames / r.releases : 0.0) << " "
+                  << r.missed << " "
+                  << (minutes > 0.0 ? r.falseTransitions / minutes : 0.0) << " "
+                  << r.grabAnalysisTime << std::endl;
+    }
+    return 0;
+}
+
+static int pipelineBenchmark(int frames)
+{
+    PipelineBenchmark benchmark;
+
+    std::cout << "pipeline debug mean_ms min_ms grabs" << std::endl;
+    for (int debug = 0; debug < 2; debug++)
+    {
+        AirCursor::DebugModes debugModes = debug ? AirCursor::DebugGeometry : AirCursor::DebugNone;
+        for (int generic = 0; generic < 2; generic++)
+        {
+            PipelineBenchmark::Result result = benchmark.run(generic, debugModes, frames);
+            std::cout << (generic ? "generic" : "specialized") << " "
+                      << (debug ? "geometry" : "none") << " "
+                      << result.meanTime << " "
+                      << result.minTime << " "
+                      << result.grabs << std::endl;
+        }
+    }
+    return 0;
+}
+
+static int kernelBenchmark(const QStringList& args)
+{
+    KernelBenchmark benchmark;
+
+    int index = args.indexOf("--baseline");
+    if (index >= 0 && index + 1 < args.size())
+    {
+        if (!benchmark.loadBaseline(args.at(index + 1))) return 1;
+    }
+
+    benchmark.run();
+    benchmark.print();
+
+    index = args.indexOf("--save");
+    if (index >= 0 && index + 1 < args.size())
+    {
+        if (!benchmark.save(args.at(index + 1))) return 1;
+    }
+    return 0;
+}
+
+static void printCodecResult(const QString& source, const CodecBenchmark& benchmark, const CodecBenchmark::Result& result)
+{
+    qreal megabytes = benchmark.width() * benchmark.height() * sizeof(XnDepthPixel) / 1000000.0;
+    std::cout << source.toLocal8Bit().constData() << " "
+              << result.frames << " "
+              << result.ratio << " "
+              << result.encodeTime << " "
+              << result.decodeTime << " "
+              << (result.encodeTime > 0.0 ? 1000.0 / result.encodeTime : 0.0) << " "
+              << (result.decodeTime > 0.0 ? 1000.0 / result.decodeTime : 0.0) << " "
+              << (result.encodeTime > 0.0 ? megabytes * 1000.0 / result.encodeTime : 0.0) << " "
+              << (result.lossless ? "yes" : "NO") << std::endl;
+}
+
+static int codecBenchmark(const QString& capture)
+{
+    CodecBenchmark benchmark;
+
+    std::cout << "source frames ratio encode_ms decode_ms encode_fps decode_fps encode_MB_per_s lossless" << std::endl;
+    if (!capture.isEmpty())
+    {
+        if (!benchmark.loadCapture(capture)) return 1;
+        CodecBenchmark::Result result = benchmark.run();
+        printCodecResult(capture, benchmark, result);
+        return result.lossless ? 0 : 1;
+    }
+
+    bool lossless = true;
+    const qreal noiseLevels[] = { 0.0, 1.5, 3.0 };
+    for (int i = 0; i < 3; i++)
+    {
+        benchmark.generate(CODEC_FRAMES, noiseLevels[i]);
+        CodecBenchmark::Result result = benchmark.run();
+        printCodecResult(QString("synthetic_noise_%1mm").arg(noiseLevels[i]), benchmark, result);
+        lossless = lossless && result.lossless;
+    }
+    return lossless ? 0 : 1;
+}
+
+static int listenerBenchmark(int events)
+{
+    ListenerBenchmark benchmark;
+    const char* names[] = { "listener", "signal_unconnected", "signal_direct", "signal_queued" };
+    const ListenerBenchmark::Receiver receivers[] = {
+        ListenerBenchmark::ReceiverListener,
+        ListenerBenchmark::ReceiverNone,
+        ListenerBenchmark::ReceiverDirectConnection,
+        ListenerBenchmark::ReceiverQueuedConnection
+    };
+
+    std::cout << "receiver events emit_ns_per_event delivery_ns_per_event delivered" << std::endl;
+    bool delivered = true;
+    for (int i = 0; i < 4; i++)
+    {
+        ListenerBenchmark::Result result = benchmark.run(receivers[i], events);
+        std::cout << names[i] << " "
+                  << events << " "
+                  << result.emitTime << " "
+                  << result.deliveryTime << " "
+                  << result.delivered << std::endl;
+
+        // nothing receives the unconnected signals
+        if (receivers[i] != ListenerBenchmark::ReceiverNone && result.delivered != events) delivered = false;
+    }
+    return delivered ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    int index = args.indexOf("--filter");
+    if (index >= 0 && index + 1 < args.size())
+    {
+        return filterBenchmark(args.at(index + 1));
+    }
+
+    index = args.indexOf("--grab");
+    if (index >= 0 && index + 2 < args.size())
+    {
+        return grabBenchmark(args.at(index + 1), args.at(index + 2), args);
+    }
+
+    index = args.indexOf("--pipeline");
+    if (index >= 0)
+    {
+        int frames = index + 1 < args.size() ? args.at(index + 1).toInt() : PIPELINE_FRAMES;
+        return pipelineBenchmark(frames > 0 ? frames : PIPELINE_FRAMES);
+    }
+
+    if (args.contains("--kernels"))
+    {
+        return kernelBenchmark(args);
+    }
+
+    index = args.indexOf("--codec");
+    if (index >= 0)
+    {
+        return codecBenchmark(index + 1 < args.size() ? args.at(index + 1) : QString());
+    }
+
+    index = args.indexOf("--listeners");
+    if (index >= 0)
+    {
+        int events = index + 1 < args.size() ? args.at(index + 1).toInt() : LISTENER_EVENTS;
+        return listenerBenchmark(events > 0 ? events : LISTENER_EVENTS);
+    }
+
+    usage();
+    return 1;
+}
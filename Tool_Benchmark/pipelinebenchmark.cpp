@@ -0,0 +1,61 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Times grab analysis of synthetic depth frames through processFrame()
+    with the specialized and the generic pipeline.
+*/
+
+#include <QElapsedTimer>
+
+#include "pipelinebenchmark.h"
+#include "synthetichand.h"
+
+const int FRAME_WIDTH = 640;
+const int FRAME_HEIGHT = 480;
+
+// hand switches between open and closed every this many frames
+const int HAND_STATE_FRAMES = 15;
+
+PipelineBenchmark::PipelineBenchmark()
+{
+    // open hand with four fingers and a fist at the frame center, no noise so runs are comparable
+    SyntheticHand generator;
+    SyntheticHand::Pose pose;
+    m_openHand.resize(FRAME_WIDTH * FRAME_HEIGHT);
+    m_closedHand.resize(FRAME_WIDTH * FRAME_HEIGHT);
+
+    pose.fingers = 4;
+    m_handPosition = generator.render(pose, m_openHand.data());
+    pose.fingers = 0;
+    generator.render(pose, m_closedHand.data());
+}
+
+PipelineBenchmark::Result PipelineBenchmark::run(bool generic, AirCursor::DebugModes debugModes, int frames)
+{
+    Result result;
+
+    AirCursor ac;
+    ac.setGenericPipeline(generic);
+    if (!ac.initProcessing(debugModes, FRAME_WIDTH, FRAME_HEIGHT)) return result;
+
+    QElapsedTimer timer;
+    qreal sum = 0.0;
+    for (int i = 0; i < frames; i++)
+    {
+        bool open = (i / HAND_STATE_FRAMES) % 2 == 0;
+        const XnDepthPixel* frame = open ? m_openHand.constData() : m_closedHand.constData();
+
+        timer.start();
+        bool grabbing = ac.processFrame(frame, m_handPosition);
+        qreal time = timer.nsecsElapsed() / 1000000.0;
+
+        sum += time;
+        if (i == 0 || time < result.minTime) result.minTime = time;
+        if (grabbing) result.grabs++;
+    }
+    if (frames > 0) result.meanTime = sum / frames;
+    return result;
+}
@@ -0,0 +1,45 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Times grab analysis of synthetic depth frames through processFrame()
+    with the specialized and the generic pipeline.
+*/
+
+#ifndef PIPELINEBENCHMARK_H
+#define PIPELINEBENCHMARK_H
+
+#include <QVector>
+
+#include "aircursor.h"
+
+class PipelineBenchmark
+{
+public:
+
+    struct Result
+    {
+        Result() : meanTime(0.0), minTime(0.0), grabs(0) {}
+
+        // per frame analysis time in milliseconds
+        qreal meanTime;
+        qreal minTime;
+
+        // frames analyzed as grabbing, same for all pipelines
+        quint32 grabs;
+    };
+
+    PipelineBenchmark();
+
+    Result run(bool generic, AirCursor::DebugModes debugModes, int frames);
+
+private:
+    // open and closed hand in front of a wall, 640x480
+    QVector<XnDepthPixel> m_openHand;
+    QVector<XnDepthPixel> m_closedHand;
+    XnPoint3D m_handPosition;
+};
+
+#endif // PIPELINEBENCHMARK_H
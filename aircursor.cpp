@@ -5,7 +5,11 @@
     Quick instructions:
     
     1. Make sure dependencies (OpenNI, Nite, OpenCV) are included in your .pro file
-    2. Add aircursor.h and aircursor.cpp to your project
+    2. Add aircursor.h, aircursor.cpp, gesturedetector.h, gesturedetector.cpp,
+       handtrajectory.h, handtrajectory.cpp, depthprojection.h,
+       aircursorkernels.h, depthcodec.h, depthcodec.cpp, depthcapture.h,
+       depthcapture.cpp, aircursorlistener.h and aircursorlistener.cpp to
+       your project
     3. Instantiate AirCursor class in your code
     4. Call AirCursor::init()
     5. Connect AirCursor signals to your QObjects
@@ -13,7 +17,19 @@
 */
 
 #include <QMetaType>
+#include <QVector3D>
+#include <qmath.h>
 #include "aircursor.h"
+#include "aircursorkernels.h"
+
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#endif
 
 // how much running grab value is affected by new values
 const qreal GRAB_SMOOTHING_FACTOR = 0.5;
@@ -27,20 +43,12 @@ const quint8 NUM_OF_SMOOTHING_POINTS = 5;
 const int DEPTH_MAP_SIZE_X = 640;
 const int DEPTH_MAP_SIZE_Y = 480;
 
-// how much further away (z distance) points are included to be part of user's hand
-// TODO change this to be in mm.
-const int DEPTH_THRESHOLD = 10;
-
 // min size for defects to be counted
 const int DEFECT_MIN_SIZE = 25;
 
 // maximum number of defects that is allowed for grabbing hand
 const int GRAB_MAX_DEFECTS = 0;
 
-// allowed depth range in millimeters.
-const int NEAR_CLIPPING_DISTANCE = 500;
-const int FAR_CLIPPING_DISTANCE = 2000;
-
 // distances whose crossing will emit warning signal
 const int NEAR_WARNING_DISTANCE = 700;
 const int FAR_WARNING_DISTANCE = 1700;
@@ -57,28 +65,144 @@ const int CONTOUR_MIN_SIZE = 1000;
 
 const QString SETTINGS_FILENAME = "aircursor.ini";
 
+// how many frames tracker thread statistics are collected before they are emitted
+const quint32 STATISTICS_PERIOD = 300;
+
+// cpu time used by the calling thread in nanoseconds, 0 where not available
+static qint64 threadCpuTime()
+{
+#ifdef Q_OS_LINUX
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) return (qint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+    return 0;
+}
+
+// default depth range in mm where nearest blob acquisition looks for a hand
+const int ENGAGEMENT_NEAR_DISTANCE = 800;
+const int ENGAGEMENT_FAR_DISTANCE = 1500;
+
+// nearest blob search samples every nth pixel in both directions
+const int BLOB_SCAN_STEP = 4;
+
+// blob is the samples at most this much (mm) behind the nearest sample and inside a
+// box of this half size (mm) around it
+const int BLOB_DEPTH = 100;
+const int BLOB_HALF_SIZE = 120;
+
+// minimum number of samples in a blob, fewer are noise
+const int BLOB_MIN_SAMPLES = 20;
+
+// how many consecutive frames a blob needs to stay within max movement (mm) before
+// a session is started. 3 frames is 100 ms at 30 fps
+const int BLOB_STABLE_FRAMES = 3;
+const qreal BLOB_MAX_MOVEMENT = 50.0;
+
+// default time in seconds a lost hand is searched for
+const qreal RECOVERY_WINDOW = 1.0;
+
+// tracking is restarted at the predicted position every nth frame while recovering
+const int RECOVERY_ATTEMPT_FRAMES = 2;
+
+// the hand is assumed to keep moving with its last velocity at most this long, in seconds
+const qreal RECOVERY_PREDICTION_TIME = 0.2;
+
+// engagement that hasn't started a session in this many seconds is forgotten
+const qreal ENGAGE_TIMEOUT = 3.0;
+
+// number of timed phases in init
+const int INIT_PHASES = 7;
+
+AirCursor::GrabParameters::GrabParameters() :
+    smoothingFactor(GRAB_SMOOTHING_FACTOR),
+    stateChangeThreshold(GRAB_STATE_CHANGE_THRESHOLD),
+    defectMinSize(DEFECT_MIN_SIZE)
+{
+}
+
 AirCursor::AirCursor(QObject *parent) :
     QThread(parent),
-    m_grabbing(false),
+    m_nextTrajectory(0),
+    m_currentTrajectory(0),
+    m_deviceIndex(-1),
+    m_playbackMode(PlaybackRealTime),
+    m_recordingEnded(false),
+    m_handUpdated(false),
+    m_transformEnabled(false),
+    m_schedulingPolicy(SchedulingDefault),
+    m_schedulingPriority(0),
+    m_lockMemory(false),
+    m_wakeIntervalSum(0.0),
+    m_schedulingDelaySum(0.0),
+    m_schedulingDelaySumSq(0.0),
+    m_grabAnalysisSum(0.0),
+    m_depthFilterSum(0.0),
+    m_activeCpuSum(0),
+    m_activeWallSum(0),
+    m_idleCpuSum(0),
+    m_idleWallSum(0),
+    m_wakeLatencySum(0.0),
+    m_sessionActive(false),
+    m_acquisitionMode(AcquisitionFocusGesture),
+    m_engagementNear(ENGAGEMENT_NEAR_DISTANCE),
+    m_engagementFar(ENGAGEMENT_FAR_DISTANCE),
+    m_blobFrames(0),
+    m_idlePolicy(IdleFullRate),
+    m_idleFrameInterval(1),
+    m_idleFrames(0),
+    m_frameTime(0.0),
+    m_engageTime(-1.0),
+    m_skipStartTime(-1.0),
+    m_recoveryWindow(RECOVERY_WINDOW),
+    m_lastHandTime(-1.0),
+    m_signalListener(this),
+    m_handId(0),
+    m_handTime(0.0),
+    m_recovering(false),
+    m_lostTime(0.0),
+    m_lostHandId(0),
+    m_recoveryFrames(0),
+    m_recoveredNiteId(0),
+    m_recoveredHandId(0),
+    m_gestureEngine(NiteGestures),
     m_init(false),
-    m_quit(false),
+    m_asyncInit(false),
+    m_initStep(-1),
+    m_grabbing(false),
+    m_grabCounter(0),
+    m_cvMemStorage(0),
     m_iplDepthMap(0),
     m_iplDebugImage(0),
+    m_depthFilters(FilterNone),
+    m_iplFilterTemp(0),
+    m_genericPipeline(false),
+    m_analyzeGrab(0),
+    m_quit(0),
+    m_paused(0),
+    m_newDataCallback(0),
     m_debugImage(0),
     m_debugImageEnabled(false),
-    m_grabCounter(0),
+    m_debugGeometryEnabled(false),
+    m_debugDepthEnabled(false),
     m_grabDetected(false),
     m_currentGrab(false),
     m_runningGrab(0.0f)
 {
     // this is needed so that QImage can be used as a parameter with queued signals
     qRegisterMetaType<QImage>("QImage");
+    qRegisterMetaType<AirCursorDebugGeometry>("AirCursorDebugGeometry");
+    qRegisterMetaType<AirCursorStatistics>("AirCursorStatistics");
+
+    m_listeners.add(&m_signalListener);
 }
 
 AirCursor::~AirCursor()
 {
     stop();
-    while (isRunning());
+    wait();
+
+    m_capture.close();
+    if (m_newDataCallback) m_depthGenerator.UnregisterFromNewDataAvailable(m_newDataCallback);
 
     if (m_debugImage)
     {
@@ -95,6 +219,11 @@ AirCursor::~AirCursor()
         cvReleaseImage(&m_iplDebugImage);
         m_iplDebugImage = 0;
     }
+    if (m_iplFilterTemp)
+    {
+        cvReleaseImage(&m_iplFilterTemp);
+        m_iplFilterTemp = 0;
+    }
     if (m_cvMemStorage)
     {
         cvReleaseMemStorage(&m_cvMemStorage);
@@ -104,10 +233,8 @@ AirCursor::~AirCursor()
     m_depthGenerator.Release();
     m_handsGenerator.Release();
     m_gestureGenerator.Release();
+    m_player.Release();
     m_context.Release();
-
-    quit();
-    wait();
 }
 
 void XN_CALLBACK_TYPE AirCursor::gestureRecognizedCB(xn::GestureGenerator& generator,
@@ -116,7 +243,8 @@ void XN_CALLBACK_TYPE AirCursor::gestureRecognizedCB(xn::GestureGenerator& gener
                    const XnPoint3D* pEndPosition, void* pCookie)
 {
     AirCursor* ac = (AirCursor*)pCookie;
-    ac->emit gestureRecognized(QString(strGesture));
+    if (!ac->m_sessionActive && ac->m_engageTime < 0.0) ac->m_engageTime = ac->engageStartTime();
+    ac->m_listeners.gestureRecognized(QString(strGesture));
 }
 
 void XN_CALLBACK_TYPE AirCursor::gestureProcessCB(xn::GestureGenerator& generator,
@@ -126,7 +254,8 @@ void XN_CALLBACK_TYPE AirCursor::gestureProcessCB(xn::GestureGenerator& generato
                 void* pCookie)
 {
     AirCursor* ac = (AirCursor*)pCookie;
-    ac->emit gestureProcess(QString(strGesture));
+    if (!ac->m_sessionActive && ac->m_engageTime < 0.0) ac->m_engageTime = ac->engageStartTime();
+    ac->m_listeners.gestureProcess(QString(strGesture));
 }
 
 void XN_CALLBACK_TYPE AirCursor::handCreateCB(xn::HandsGenerator& generator,
@@ -134,7 +263,32 @@ void XN_CALLBACK_TYPE AirCursor::handCreateCB(xn::HandsGenerator& generator,
             XnFloat fTime, void* pCookie)
 {
     AirCursor* ac = (AirCursor*)pCookie;
-    ac->emit handCreate(pPosition->X, pPosition->Y, pPosition->Z, fTime);
+    ac->m_gestureDetector.reset();
+    ac->m_lastHandTime = -1.0;
+
+    // hand found near a lost hand continues as the same hand with the same trajectory
+    if (ac->m_recovering)
+    {
+        ac->m_recovering = false;
+        ac->m_recoveredNiteId = nId;
+        ac->m_recoveredHandId = ac->m_lostHandId;
+
+        ac->m_handId = ac->m_lostHandId;
+        ac->m_handTime = fTime;
+        ac->m_listeners.handRecovered(ac->handFrame(*pPosition));
+        return;
+    }
+    ac->m_recoveredNiteId = 0;
+
+    // take the oldest trajectory into use for the new hand
+    int index = ac->m_nextTrajectory;
+    ac->m_nextTrajectory = (index + 1) % MAX_TRACKED_HANDS;
+    ac->m_trajectories[index].clear(nId);
+    ac->m_currentTrajectory.fetchAndStoreOrdered(index);
+
+    ac->m_handId = nId;
+    ac->m_handTime = fTime;
+    ac->m_listeners.handCreate(ac->handFrame(*pPosition));
 }
 
 void XN_CALLBACK_TYPE AirCursor::handUpdateCB(xn::HandsGenerator& generator,
@@ -143,22 +297,68 @@ void XN_CALLBACK_TYPE AirCursor::handUpdateCB(xn::HandsGenerator& generator,
 {
 
     AirCursor* ac = (AirCursor*)pCookie;
+
+    // smoothed velocity in mm/s for predicting where a lost hand went
+    if (ac->m_lastHandTime >= 0.0 && fTime > ac->m_lastHandTime)
+    {
+        qreal dt = fTime - ac->m_lastHandTime;
+        ac->m_handVelocity.X = 0.5 * ac->m_handVelocity.X + 0.5 * (pPosition->X - ac->m_handPosRealWorld.X) / dt;
+        ac->m_handVelocity.Y = 0.5 * ac->m_handVelocity.Y + 0.5 * (pPosition->Y - ac->m_handPosRealWorld.Y) / dt;
+        ac->m_handVelocity.Z = 0.5 * ac->m_handVelocity.Z + 0.5 * (pPosition->Z - ac->m_handPosRealWorld.Z) / dt;
+    }
+    else
+    {
+        ac->m_handVelocity.X = ac->m_handVelocity.Y = ac->m_handVelocity.Z = 0.0;
+    }
+    ac->m_lastHandTime = fTime;
+
+    ac->m_handId = nId == ac->m_recoveredNiteId ? ac->m_recoveredHandId : nId;
+    ac->m_handTime = fTime;
     ac->m_handPosRealWorld = *pPosition;
-    ac->m_depthGenerator.ConvertRealWorldToProjective(1, pPosition, &(ac->m_handPosProjected));
+    ac->m_handUpdated = true;
+    ac->m_handPosProjected = ac->m_projection.toProjective(*pPosition);
     ac->newHandPoint(pPosition->X, pPosition->Y, pPosition->Z);
 
+    if (ac->m_gestureEngine == NativeGestures)
+    {
+        // raw positions are used, smoothing would add latency
+        GestureDetector::Gesture gesture = ac->m_gestureDetector.addPoint(pPosition->X, pPosition->Y, pPosition->Z, fTime);
+        if (gesture != GestureDetector::GestureNone)
+        {
+            qreal velocity = ac->m_gestureDetector.velocity();
+            qreal angle = ac->m_gestureDetector.angle();
+            switch (gesture)
+            {
+                case GestureDetector::GestureSwipeUp: ac->m_listeners.swipeUp(velocity, angle); break;
+                case GestureDetector::GestureSwipeDown: ac->m_listeners.swipeDown(velocity, angle); break;
+                case GestureDetector::GestureSwipeLeft: ac->m_listeners.swipeLeft(velocity, angle); break;
+                case GestureDetector::GestureSwipeRight: ac->m_listeners.swipeRight(velocity, angle); break;
+                case GestureDetector::GesturePush: ac->m_listeners.push(ac->handFrame(*pPosition), velocity, angle); break;
+                default: break;
+            }
+            emit ac->gestureLatency(GestureDetector::gestureName(gesture), ac->m_gestureDetector.latency());
+        }
+    }
+
+    qint64 analysisStart = ac->m_analysisTimer.nsecsElapsed();
     ac->analyzeGrab();
     ac->updateState();
+    ac->m_grabAnalysisSum += (ac->m_analysisTimer.nsecsElapsed() - analysisStart) / 1000000.0;
+    ac->m_statistics.analyzedFrames++;
+
+    int index = ac->trajectoryIndex(ac->m_handId);
+    XnPoint3D pos = ac->transformed(*pPosition);
+    if (index >= 0) ac->m_trajectories[index].add(pos.X, pos.Y, pos.Z, fTime, ac->m_grabbing);
     //emit ac->handUpdate(pPosition->X, pPosition->Y, pPosition->Z, fTime, ac->m_grabbing);
-    emit ac->handUpdate(ac->m_handPosSmooth.X, ac->m_handPosSmooth.Y, ac->m_handPosSmooth.Z, fTime, ac->m_grabbing);
+    ac->m_listeners.handUpdate(ac->handFrame(ac->m_handPosSmooth));
 
     if (ac->m_handPosRealWorld.Z < NEAR_WARNING_DISTANCE)
     {
-        emit ac->handTooClose();
+        ac->m_listeners.handTooClose();
     }
     else if (ac->m_handPosRealWorld.Z > FAR_WARNING_DISTANCE)
     {
-        emit ac->handTooFar();
+        ac->m_listeners.handTooFar();
     }
 }
 
@@ -167,7 +367,19 @@ void XN_CALLBACK_TYPE AirCursor::handDestroyCB(xn::HandsGenerator& generator,
              void* pCookie)
 {
     AirCursor* ac = (AirCursor*)pCookie;
-    emit ac->handDestroy(fTime);
+    ac->m_gestureDetector.reset();
+
+    // search for the hand for a while before giving up, see updateRecovery()
+    if (ac->m_recoveryWindow > 0.0)
+    {
+        ac->m_recovering = true;
+        ac->m_lostTime = fTime;
+        ac->m_lostHandId = nId == ac->m_recoveredNiteId ? ac->m_recoveredHandId : nId;
+        ac->m_recoveryFrames = 0;
+        ac->m_listeners.handLost(fTime);
+        return;
+    }
+    ac->m_listeners.handDestroy(fTime);
     //std::cout << "hand destroy frame: " << ac->m_frame << std::endl;
 }
 
@@ -175,84 +387,564 @@ void XN_CALLBACK_TYPE AirCursor::sessionStartCB(const XnPoint3D& pFocus, void* U
 {
     AirCursor* ac = (AirCursor*)UserCxt;
     //std::cout << "session start frame: " << ac->m_frame << std::endl;
-    emit ac->sessionStart();
+    ac->m_sessionActive = true;
+    if (ac->m_engageTime >= 0.0)
+    {
+        ac->m_statistics.wakeups++;
+        ac->m_wakeLatencySum += (ac->m_frameTime - ac->m_engageTime) * 1000.0;
+        ac->m_engageTime = -1.0;
+    }
+    ac->m_listeners.sessionStart();
 }
 void XN_CALLBACK_TYPE AirCursor::sessionEndCB(void* UserCxt)
 {
     AirCursor* ac = (AirCursor*)UserCxt;
-    emit ac->sessionEnd();
+    ac->m_sessionActive = false;
+
+    // lost hand can't be recovered without a session
+    if (ac->m_recovering)
+    {
+        ac->m_recovering = false;
+        ac->m_listeners.handDestroy(ac->m_lostTime + ac->m_recoveryWindow);
+    }
+    ac->m_listeners.sessionEnd();
     //std::cout << "session ended frame: " << ac->m_frame << std::endl;
 }
 
 void XN_CALLBACK_TYPE AirCursor::pushCB(XnFloat fVelocity, XnFloat fAngle, void *UserCxt)
 {
     AirCursor* ac = (AirCursor*)UserCxt;
-    emit ac->push(ac->m_handPosRealWorld.X, ac->m_handPosRealWorld.Y, ac->m_handPosRealWorld.Z, fVelocity, fAngle);
+    ac->m_listeners.push(ac->handFrame(ac->m_handPosRealWorld), fVelocity, fAngle);
 }
 
 void XN_CALLBACK_TYPE AirCursor::swipeUpCB(XnFloat fVelocity, XnFloat fAngle, void* cxt)
 {
     //std::cout << "Swipe UP velocity: " << fVelocity << " angle: " << fAngle << std::endl;
     AirCursor* ac = (AirCursor*)cxt;
-    ac->emit swipeUp(fVelocity, fAngle);
+    ac->m_listeners.swipeUp(fVelocity, fAngle);
 }
 void XN_CALLBACK_TYPE AirCursor::swipeDownCB(XnFloat fVelocity, XnFloat fAngle, void* cxt)
 {
     //std::cout << "Swipe DOWN velocity: " << fVelocity << " angle: " << fAngle << std::endl;
     AirCursor* ac = (AirCursor*)cxt;
-    ac->emit swipeDown(fVelocity, fAngle);
+    ac->m_listeners.swipeDown(fVelocity, fAngle);
 }
 void XN_CALLBACK_TYPE AirCursor::swipeLeftCB(XnFloat fVelocity, XnFloat fAngle, void* cxt)
 {
     //std::cout << "Swipe LEFT velocity: " << fVelocity << " angle: " << fAngle << std::endl;
     AirCursor* ac = (AirCursor*)cxt;
-    ac->emit swipeLeft(fVelocity, fAngle);
+    ac->m_listeners.swipeLeft(fVelocity, fAngle);
 }
 void XN_CALLBACK_TYPE AirCursor::swipeRightCB(XnFloat fVelocity, XnFloat fAngle, void* cxt)
 {
     //std::cout << "Swipe RIGHT velocity: " << fVelocity << " angle: " << fAngle << std::endl;
     AirCursor* ac = (AirCursor*)cxt;
-    ac->emit swipeRight(fVelocity, fAngle);
+    ac->m_listeners.swipeRight(fVelocity, fAngle);
+}
+
+QStringList AirCursor::availableDevices()
+{
+    QStringList devices;
+
+    xn::Context context;
+    if (context.Init() != XN_STATUS_OK) return devices;
+
+    xn::NodeInfoList list;
+    if (context.EnumerateProductionTrees(XN_NODE_TYPE_DEPTH, NULL, list) == XN_STATUS_OK)
+    {
+        for (xn::NodeInfoList::Iterator it = list.Begin(); it != list.End(); ++it)
+        {
+            xn::NodeInfo info = *it;
+            QString name = info.GetInstanceName();
+            if (name.isEmpty()) name = QString("depth %1").arg(devices.size());
+            devices.push_back(name + " (" + info.GetCreationInfo() + ")");
+        }
+    }
+
+    context.Release();
+    return devices;
+}
+
+void AirCursor::setDevice(int index)
+{
+    if (m_init) return;
+    m_deviceIndex = index;
+    m_recording.clear();
+}
+
+void AirCursor::setRecording(const QString& fileName, PlaybackMode mode)
+{
+    if (m_init) return;
+    m_recording = fileName;
+    m_playbackMode = mode;
+    m_deviceIndex = -1;
+}
+
+void AirCursor::setCapture(const QString& fileName)
+{
+    if (m_init) return;
+    m_captureFile = fileName;
+}
+
+void AirCursor::setDepthFilters(DepthFilters filters)
+{
+    if (m_init) return;
+    m_depthFilters = filters;
+}
+
+void AirCursor::setAcquisitionMode(AcquisitionMode mode)
+{
+    m_acquisitionMode = mode;
+}
+
+void AirCursor::setEngagementRange(int nearDistance, int farDistance)
+{
+    m_engagementNear = nearDistance;
+    m_engagementFar = farDistance;
+}
+
+void AirCursor::setRecoveryWindow(qreal seconds)
+{
+    m_recoveryWindow = seconds;
+}
+
+void AirCursor::setIdlePolicy(IdlePolicy policy, int frameInterval)
+{
+    m_idlePolicy = policy;
+    m_idleFrameInterval = qMax(1, frameInterval);
+}
+
+void AirCursor::setGrabParameters(const GrabParameters& parameters)
+{
+    m_grabParameters = parameters;
+}
+
+void AirCursor::setTransform(const QMatrix4x4& transform)
+{
+    m_transform = transform;
+    m_transformEnabled = !transform.isIdentity();
+}
+
+void AirCursor::setCpuAffinity(const QList<int>& cpus)
+{
+    m_cpuAffinity = cpus;
+}
+
+void AirCursor::setScheduling(SchedulingPolicy policy, int priority)
+{
+    m_schedulingPolicy = policy;
+    m_schedulingPriority = priority;
+}
+
+void AirCursor::setLockMemory(bool lock)
+{
+    m_lockMemory = lock;
+}
+
+XnPoint3D AirCursor::transformed(const XnPoint3D& point) const
+{
+    if (!m_transformEnabled) return point;
+
+    QVector3D v = m_transform.map(QVector3D(point.X, point.Y, point.Z));
+    XnPoint3D result;
+    result.X = v.x(); result.Y = v.y(); result.Z = v.z();
+    return result;
+}
+
+// hand event data of the current hand at given untransformed position
+AirCursorHandFrame AirCursor::handFrame(const XnPoint3D& position) const
+{
+    XnPoint3D pos = transformed(position);
+    AirCursorHandFrame frame;
+    frame.handId = m_handId;
+    frame.x = pos.X;
+    frame.y = pos.Y;
+    frame.z = pos.Z;
+    frame.time = m_handTime;
+    frame.grabbing = m_grabbing;
+    return frame;
+}
+
+bool AirCursor::addListener(AirCursorListener* listener)
+{
+    return m_listeners.add(listener);
+}
+
+void AirCursor::removeListener(AirCursorListener* listener)
+{
+    // the signals can't be removed
+    if (listener == &m_signalListener) return;
+    m_listeners.remove(listener);
+}
+
+void AirCursor::SignalListener::handCreate(const AirCursorHandFrame& frame)
+{
+    emit m_ac->handCreate(frame.x, frame.y, frame.z, frame.time);
+}
+
+void AirCursor::SignalListener::handUpdate(const AirCursorHandFrame& frame)
+{
+    emit m_ac->handUpdate(frame.x, frame.y, frame.z, frame.time, frame.grabbing);
+}
+
+void AirCursor::SignalListener::handDestroy(qreal time)
+{
+    emit m_ac->handDestroy(time);
+}
+
+void AirCursor::SignalListener::handLost(qreal time)
+{
+    emit m_ac->handLost(time);
+}
+
+void AirCursor::SignalListener::handRecovered(const AirCursorHandFrame& frame)
+{
+    emit m_ac->handRecovered(frame.x, frame.y, frame.z, frame.time);
+}
+
+void AirCursor::SignalListener::handTooClose()
+{
+    emit m_ac->handTooClose();
+}
+
+void AirCursor::SignalListener::handTooFar()
+{
+    emit m_ac->handTooFar();
+}
+
+void AirCursor::SignalListener::grab(const AirCursorHandFrame& frame)
+{
+    emit m_ac->grab(frame.x, frame.y, frame.z);
+}
+
+void AirCursor::SignalListener::grabRelease(const AirCursorHandFrame& frame)
+{
+    emit m_ac->grabRelease(frame.x, frame.y, frame.z);
+}
+
+void AirCursor::SignalListener::push(const AirCursorHandFrame& frame, qreal velocity, qreal angle)
+{
+    emit m_ac->push(frame.x, frame.y, frame.z, velocity, angle);
+}
+
+void AirCursor::SignalListener::swipeUp(qreal velocity, qreal angle)
+{
+    emit m_ac->swipeUp(velocity, angle);
+}
+
+void AirCursor::SignalListener::swipeDown(qreal velocity, qreal angle)
+{
+    emit m_ac->swipeDown(velocity, angle);
+}
+
+void AirCursor::SignalListener::swipeLeft(qreal velocity, qreal angle)
+{
+    emit m_ac->swipeLeft(velocity, angle);
+}
+
+void AirCursor::SignalListener::swipeRight(qreal velocity, qreal angle)
+{
+    emit m_ac->swipeRight(velocity, angle);
+}
+
+void AirCursor::SignalListener::gestureRecognized(const QString& gesture)
+{
+    emit m_ac->gestureRecognized(gesture);
+}
+
+void AirCursor::SignalListener::gestureProcess(const QString& gesture)
+{
+    emit m_ac->gestureProcess(gesture);
+}
+
+void AirCursor::SignalListener::sessionStart()
+{
+    emit m_ac->sessionStart();
+}
+
+void AirCursor::SignalListener::sessionEnd()
+{
+    emit m_ac->sessionEnd();
+}
+
+// creates depth generator from the selected sensor or recording
+bool AirCursor::createDepthGenerator()
+{
+    XnStatus rc = XN_STATUS_OK;
+
+    if (!m_recording.isEmpty())
+    {
+        rc = m_context.OpenFileRecording(m_recording.toLocal8Bit().constData(), m_player);
+        if (rc != XN_STATUS_OK)
+        {
+            std::cout << "opening recording " << m_recording.toLocal8Bit().constData() << " failed: " << xnGetStatusString(rc) << std::endl;
+            return false;
+        }
+
+        rc = m_context.FindExistingNode(XN_NODE_TYPE_DEPTH, m_depthGenerator);
+        if (rc != XN_STATUS_OK)
+        {
+            std::cout << "no depth in recording: " << xnGetStatusString(rc) << std::endl;
+            return false;
+        }
+
+        if (m_playbackMode == PlaybackFastest)
+        {
+            m_player.SetRepeat(false);
+            m_player.SetPlaybackSpeed(XN_PLAYBACK_SPEED_FASTEST);
+        }
+        return true;
+    }
+
+    if (m_deviceIndex >= 0)
+    {
+        xn::NodeInfoList list;
+        rc = m_context.EnumerateProductionTrees(XN_NODE_TYPE_DEPTH, NULL, list);
+        if (rc != XN_STATUS_OK)
+        {
+            std::cout << "depth sensor enumeration failed: " << xnGetStatusString(rc) << std::endl;
+            return false;
+        }
+
+        int index = 0;
+        for (xn::NodeInfoList::Iterator it = list.Begin(); it != list.End(); ++it, ++index)
+        {
+            if (index != m_deviceIndex) continue;
+
+            xn::NodeInfo info = *it;
+            rc = m_context.CreateProductionTree(info, m_depthGenerator);
+            if (rc != XN_STATUS_OK)
+            {
+                std::cout << "node creation failed: " << xnGetStatusString(rc) << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        std::cout << "depth sensor " << m_deviceIndex << " not found" << std::endl;
+        return false;
+    }
+
+    // create a DepthGenerator node
+    rc = m_depthGenerator.Create(m_context);
+    if (rc != XN_STATUS_OK)
+    {
+        std::cout << "node creation failed: " << xnGetStatusString(rc) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// applies thread settings from the tracker thread itself
+void AirCursor::applyThreadSettings()
+{
+#ifdef Q_OS_LINUX
+    if (!m_cpuAffinity.isEmpty())
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int i = 0; i < m_cpuAffinity.size(); i++) CPU_SET(m_cpuAffinity.at(i), &cpus);
+
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (err != 0)
+        {
+            std::cout << "WARNING: setting cpu affinity failed: " << strerror(err) << std::endl;
+        }
+    }
+
+    if (m_schedulingPolicy != SchedulingDefault)
+    {
+        int policy = (m_schedulingPolicy == SchedulingFifo) ? SCHED_FIFO : SCHED_RR;
+        sched_param param;
+        param.sched_priority = qBound(sched_get_priority_min(policy), m_schedulingPriority, sched_get_priority_max(policy));
+
+        int err = pthread_setschedparam(pthread_self(), policy, &param);
+        if (err != 0)
+        {
+            std::cout << "WARNING: setting real time scheduling failed: " << strerror(err) << std::endl;
+        }
+    }
+
+    if (m_lockMemory)
+    {
+        // buffers are allocated in init() so they are locked by MCL_CURRENT
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        {
+            std::cout << "WARNING: locking memory failed: " << strerror(errno) << std::endl;
+        }
+    }
+#else
+    if (m_schedulingPolicy != SchedulingDefault || m_lockMemory)
+    {
+        std::cout << "WARNING: real time scheduling and memory locking are only supported on linux" << std::endl;
+    }
+#endif
+}
+
+// adds one frame's timing to the current statistics period and emits the statistics
+// when the period is full. times in milliseconds
+void AirCursor::updateFrameStatistics(qreal wakeInterval, qreal frameInterval)
+{
+    qreal delay = wakeInterval - frameInterval;
+
+    m_statistics.frames++;
+    m_wakeIntervalSum += wakeInterval;
+    m_schedulingDelaySum += delay;
+    m_schedulingDelaySumSq += delay * delay;
+    if (delay > m_statistics.maxSchedulingDelay) m_statistics.maxSchedulingDelay = delay;
+
+    if (m_statistics.frames >= STATISTICS_PERIOD) emitStatistics();
+}
+
+// emits the statistics collected so far and starts a new period
+void AirCursor::emitStatistics()
+{
+    if (m_statistics.frames > 0)
+    {
+        qreal n = m_statistics.frames;
+        qreal meanDelay = m_schedulingDelaySum / n;
+        m_statistics.frameInterval = m_wakeIntervalSum / n;
+        m_statistics.schedulingJitter = qSqrt(qMax((qreal)0.0, m_schedulingDelaySumSq / n - meanDelay * meanDelay));
+    }
+    if (m_statistics.analyzedFrames > 0)
+    {
+        m_statistics.grabAnalysisTime = m_grabAnalysisSum / m_statistics.analyzedFrames;
+        m_statistics.depthFilterTime = m_depthFilterSum / m_statistics.analyzedFrames;
+    }
+    if (m_activeWallSum > 0) m_statistics.activeCpuLoad = (qreal)m_activeCpuSum / m_activeWallSum;
+    if (m_idleWallSum > 0) m_statistics.idleCpuLoad = (qreal)m_idleCpuSum / m_idleWallSum;
+    if (m_statistics.wakeups > 0) m_statistics.wakeLatency = m_wakeLatencySum / m_statistics.wakeups;
+    DepthCaptureStatistics capture = m_capture.takeStatistics();
+    m_statistics.capturedFrames = capture.frames;
+    m_statistics.droppedCaptureFrames = capture.droppedFrames;
+    if (capture.frames > 0) m_statistics.captureTime = capture.time / capture.frames;
+    if (capture.encodedBytes > 0) m_statistics.captureRatio = (qreal)capture.rawBytes / capture.encodedBytes;
+    emit statisticsUpdate(m_statistics);
+
+    m_statistics = AirCursorStatistics();
+    m_wakeIntervalSum = m_schedulingDelaySum = m_schedulingDelaySumSq = 0.0;
+    m_grabAnalysisSum = m_depthFilterSum = 0.0;
+    m_activeCpuSum = m_activeWallSum = m_idleCpuSum = m_idleWallSum = 0;
+    m_wakeLatencySum = 0.0;
+}
+
+void AirCursor::setGestureEngine(GestureEngine engine)
+{
+    if (m_init) return;
+    m_gestureEngine = engine;
+}
+
+void AirCursor::setGestureSettings(const GestureDetector::Settings& settings)
+{
+    m_gestureDetector.setSettings(settings);
+}
+
+const HandTrajectory& AirCursor::trajectory() const
+{
+    return m_trajectories[m_currentTrajectory.fetchAndAddOrdered(0)];
+}
+
+const HandTrajectory* AirCursor::trajectory(quint32 handId) const
+{
+    int index = trajectoryIndex(handId);
+    if (index < 0) return 0;
+    return &m_trajectories[index];
+}
+
+int AirCursor::trajectoryIndex(quint32 handId) const
+{
+    for (int i = 0; i < MAX_TRACKED_HANDS; i++)
+    {
+        if (m_trajectories[i].handId() == handId) return i;
+    }
+    return -1;
+}
+
+bool AirCursor::init(bool makeDebugImage)
+{
+    return init(makeDebugImage ? DebugImage : DebugNone);
+}
+
+bool AirCursor::init(DebugModes debugModes)
+{
+    if (m_init) return true;
+
+    m_debugImageEnabled = debugModes.testFlag(DebugImage);
+    m_debugGeometryEnabled = debugModes.testFlag(DebugGeometry);
+    m_debugDepthEnabled = debugModes.testFlag(DebugDepth);
+
+    return initSensor();
 }
 
-bool AirCursor::init(bool makeDebugImage)
+void AirCursor::initAsync(DebugModes debugModes, Priority priority)
 {
-    if (m_init) return true;
+    if (m_init || isRunning()) return;
+
+    m_debugImageEnabled = debugModes.testFlag(DebugImage);
+    m_debugGeometryEnabled = debugModes.testFlag(DebugGeometry);
+    m_debugDepthEnabled = debugModes.testFlag(DebugDepth);
+
+    // run() initializes before tracking
+    m_asyncInit = true;
+    start(priority);
+}
 
-    m_debugImageEnabled = makeDebugImage;
+// opens the sensor and creates the nite pipeline, timing each phase. every OpenNI call
+// here goes to the same context, so the phases run one after another
+bool AirCursor::initSensor()
+{
+    m_initTimer.start();
+    m_initStep = -1;
 
     XnStatus rc = XN_STATUS_OK;
 
     // init OpenNI context
+    nextInitPhase("context");
     rc = m_context.Init();
     m_context.SetGlobalMirror(true);
     if (rc != XN_STATUS_OK)
     {
         std::cout << "ERROR: init failed: " << xnGetStatusString(rc) << std::endl;
-        return false;
+        return failInit();
     }
 
     // create a DepthGenerator node
-    rc = m_depthGenerator.Create(m_context);
-    if (rc != XN_STATUS_OK)
+    nextInitPhase("depth");
+    if (!createDepthGenerator()) return failInit();
+
+    // cache projection parameters so that coordinate conversions don't need to call OpenNI
+    XnFieldOfView fov;
+    xn::MapOutputMode mode;
+    if (m_depthGenerator.GetFieldOfView(fov) == XN_STATUS_OK && m_depthGenerator.GetMapOutputMode(mode) == XN_STATUS_OK)
     {
-        std::cout << "node creation failed: " << xnGetStatusString(rc) << std::endl;
-        return false;
+        m_projection.setFieldOfView(fov.fHFOV, fov.fVFOV, mode.nXRes, mode.nYRes);
     }
+    else
+    {
+        std::cout << "WARNING: reading field of view failed, using Kinect defaults" << std::endl;
+    }
+
+    // the tracker sleeps until the sensor has a frame, recordings are read without waiting
+    if (m_recording.isEmpty()) m_depthGenerator.RegisterToNewDataAvailable(newDataCB, this, m_newDataCallback);
+
+    // capture failing is reported but doesn't prevent tracking
+    if (!m_captureFile.isEmpty()) m_capture.create(m_captureFile, m_projection.xRes(), m_projection.yRes());
 
     // create the gesture and hands generators
+    nextInitPhase("gestures");
     rc = m_gestureGenerator.Create(m_context);
     if (rc != XN_STATUS_OK)
     {
         std::cout << "gesture generator creation failed: " << xnGetStatusString(rc) << std::endl;
-        return false;
+        return failInit();
     }
 
+    nextInitPhase("hands");
     rc = m_handsGenerator.Create(m_context);
     if (rc != XN_STATUS_OK)
     {
         std::cout << "hands generator creation failed: " << xnGetStatusString(rc) << std::endl;
-        return false;
+        return failInit();
     }
 
     // register to callbacks
@@ -261,174 +953,500 @@ bool AirCursor::init(bool makeDebugImage)
     m_handsGenerator.RegisterHandCallbacks(handCreateCB, handUpdateCB, handDestroyCB, this, h2);
 
     // init session manager
+    nextInitPhase("session");
     rc = m_sessionManager.Initialize(&m_context, "Wave,Click", NULL);
     if (rc != XN_STATUS_OK)
     {
         std::cout << "session manager init failed: " << xnGetStatusString(rc) << std::endl;
-        return false;
+        return failInit();
     }
 
     // register to session callbacks
     m_sessionManager.RegisterSession(this, &sessionStartCB, &sessionEndCB);
 
     // start generating data
+    nextInitPhase("start");
     rc = m_context.StartGeneratingAll();
     if (rc != XN_STATUS_OK)
     {
         std::cout << "data generating start failed: " << xnGetStatusString(rc) << std::endl;
-        return false;
+        return failInit();
+    }
+
+    // native gestures are detected in hand update callback
+    if (m_gestureEngine == NiteGestures)
+    {
+        m_pushDetector.RegisterPush(this, pushCB);
+        m_sessionManager.AddListener(&m_pushDetector);
+
+        m_swipeDetector.RegisterSwipeUp(this, &swipeUpCB);
+        m_swipeDetector.RegisterSwipeDown(this, &swipeDownCB);
+        m_swipeDetector.RegisterSwipeLeft(this, &swipeLeftCB);
+        m_swipeDetector.RegisterSwipeRight(this, &swipeRightCB);
+        m_sessionManager.AddListener(&m_swipeDetector);
+    }
+
+    nextInitPhase("analysis");
+    initAnalysis();
+    nextInitPhase(0);
+
+    m_init = true;
+    emit initReady(m_initTimer.nsecsElapsed() / 1000000.0);
+    return true;
+}
+
+// reports the time of the finished init phase and starts timing the given one, 0 when done
+void AirCursor::nextInitPhase(const char* phase)
+{
+    if (m_initStep >= 0)
+    {
+        emit initProgress(m_initPhase, m_initStep + 1, INIT_PHASES, m_initPhaseTimer.nsecsElapsed() / 1000000.0);
     }
+    m_initStep++;
+    m_initPhase = phase;
+    m_initPhaseTimer.start();
+}
+
+bool AirCursor::failInit()
+{
+    std::cout << "init failed in phase " << m_initPhase.toLocal8Bit().constData() << std::endl;
+    emit initFailed(m_initPhase);
+    return false;
+}
+
+bool AirCursor::initProcessing(DebugModes debugModes, int width, int height)
+{
+    if (m_init) return true;
+
+    m_debugImageEnabled = debugModes.testFlag(DebugImage);
+    m_debugGeometryEnabled = debugModes.testFlag(DebugGeometry);
+    m_debugDepthEnabled = debugModes.testFlag(DebugDepth);
+
+    // projection uses the kinect field of view with the given resolution
+    m_projection.setResolution(width, height);
+
+    initAnalysis();
+
+    m_init = true;
+    return true;
+}
+
+bool AirCursor::processFrame(const XnDepthPixel* depthMap, const XnPoint3D& handPosition)
+{
+    if (!m_init) return false;
+
+    m_handPosRealWorld = handPosition;
+    m_handPosProjected = m_projection.toProjective(handPosition);
+
+    qint64 analysisStart = m_analysisTimer.nsecsElapsed();
+    (this->*m_analyzeGrab)(depthMap);
+    updateState();
+    m_grabAnalysisSum += (m_analysisTimer.nsecsElapsed() - analysisStart) / 1000000.0;
+    m_statistics.analyzedFrames++;
+
+    return m_grabbing;
+}
 
-    m_pushDetector.RegisterPush(this, pushCB);
-    m_sessionManager.AddListener(&m_pushDetector);
+void AirCursor::setGenericPipeline(bool generic)
+{
+    if (m_init) return;
+    m_genericPipeline = generic;
+}
 
-    m_swipeDetector.RegisterSwipeUp(this, &swipeUpCB);
-    m_swipeDetector.RegisterSwipeDown(this, &swipeDownCB);
-    m_swipeDetector.RegisterSwipeLeft(this, &swipeLeftCB);
-    m_swipeDetector.RegisterSwipeRight(this, &swipeRightCB);
-    m_sessionManager.AddListener(&m_swipeDetector);
+// allocates the working images for the depth resolution and selects the analysis pipeline
+void AirCursor::initAnalysis()
+{
+    int width = m_projection.xRes();
+    int height = m_projection.yRes();
 
     // 8bit depth map
-    m_iplDepthMap = cvCreateImage(cvSize(DEPTH_MAP_SIZE_X, DEPTH_MAP_SIZE_Y), IPL_DEPTH_8U, 1);
+    m_iplDepthMap = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 1);
 
     // opencv mem storage
     m_cvMemStorage = cvCreateMemStorage(0);
 
+    // median needs a separate destination image
+    if (m_depthFilters & FilterMedian)
+    {
+        m_iplFilterTemp = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 1);
+    }
+
+    m_analysisTimer.start();
+
     if (m_debugImageEnabled)
     {
         // 24bit rgb888 debug image
-        m_iplDebugImage = cvCreateImage(cvSize(DEPTH_MAP_SIZE_X, DEPTH_MAP_SIZE_Y), IPL_DEPTH_8U, 3);
+        m_iplDebugImage = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 3);
 
         // Same debug image as a QImage
-        m_debugImage = new QImage(DEPTH_MAP_SIZE_X, DEPTH_MAP_SIZE_Y, QImage::Format_RGB888);
+        m_debugImage = new QImage(width, height, QImage::Format_RGB888);
     }
 
-    m_init = true;
-    return true;
+    if (m_debugDepthEnabled)
+    {
+        // 8bit depth with grayscale color table and 1bit hand mask
+        m_debugDepthImage = QImage(width, height, QImage::Format_Indexed8);
+        QVector<QRgb> grayscale(256);
+        for (int i = 0; i < 256; i++) grayscale[i] = qRgb(i, i, i);
+        m_debugDepthImage.setColorTable(grayscale);
+
+        m_debugHandMask = QImage(width, height, QImage::Format_Mono);
+    }
+
+    // pipeline is chosen once here instead of testing debug modes and strides per pixel
+    bool debug = m_debugImageEnabled || m_debugGeometryEnabled || m_debugDepthEnabled;
+    bool kinectSize = FixedGeometry<DEPTH_MAP_SIZE_X, DEPTH_MAP_SIZE_Y>::matches(width, height, m_iplDepthMap->widthStep);
+    if (kinectSize && !m_genericPipeline)
+    {
+        if (debug) m_analyzeGrab = &AirCursor::analyzeGrabFrame<true, FixedGeometry<DEPTH_MAP_SIZE_X, DEPTH_MAP_SIZE_Y> >;
+        else m_analyzeGrab = &AirCursor::analyzeGrabFrame<false, FixedGeometry<DEPTH_MAP_SIZE_X, DEPTH_MAP_SIZE_Y> >;
+    }
+    else
+    {
+        m_analyzeGrab = &AirCursor::analyzeGrabFrame<true, DynamicGeometry>;
+    }
+}
+
+void AirCursor::analyzeGrab()
+{
+    (this->*m_analyzeGrab)(m_depthGenerator.GetDepthMap());
 }
 
 void AirCursor::run()
 {
-    if (!m_init)
+    if (m_asyncInit)
     {
-        m_context.Shutdown();
-        return;
+        m_asyncInit = false;
+        initSensor();
     }
 
+    // nodes of a failed init are released by the destructor
+    if (!m_init) return;
+
+    applyThreadSettings();
+
     XnStatus rc = XN_STATUS_OK;
+    m_recordingEnded = false;
+
+    // restarted after stop()
+    if (!m_depthGenerator.IsGenerating())
+    {
+        rc = m_context.StartGeneratingAll();
+        if (rc != XN_STATUS_OK)
+        {
+            std::cout << "data generating restart failed: " << xnGetStatusString(rc) << std::endl;
+            return;
+        }
+    }
 
-    bool quit = false;
-    while (!quit)
+    // wakeup times and sensor timestamps of the previous frame for the statistics
+    QElapsedTimer wakeTimer;
+    wakeTimer.start();
+    qint64 lastWake = -1;
+    XnUInt64 lastTimestamp = 0;
+
+    // thread cpu time and wall time are added to idle or active state of the previous frame
+    qint64 lastCpu = threadCpuTime();
+    qint64 lastWall = wakeTimer.nsecsElapsed();
+    bool lastIdle = false;
+
+    while (!m_quit.fetchAndAddOrdered(0))
     {
+        if (m_paused.fetchAndAddOrdered(0))
+        {
+            if (!waitWhilePaused()) break;
+
+            // time spent paused is not a frame interval or idle time
+            lastWake = -1;
+            lastCpu = threadCpuTime();
+            lastWall = wakeTimer.nsecsElapsed();
+            continue;
+        }
+
+        // recordings have their frames ready or within a frame interval, sensor waits can be interrupted
+        if (m_recording.isEmpty() && !waitForFrame()) continue;
 
-        // Wait for new data to be available
-        rc = m_context.WaitOneUpdateAll(m_depthGenerator);
+        // idle until a session starts or a focus gesture or a blob is seen, and then at full rate
+        bool idle = !m_sessionActive && m_engageTime < 0.0 && m_blobFrames == 0;
+        bool process = true;
+        if (idle && m_idlePolicy == IdleSkipFrames) process = m_idleFrames % m_idleFrameInterval == 0;
+        if (idle) m_idleFrames++;
+        else m_idleFrames = 0;
+
+        // Wait for new data to be available. skipped frames only update the depth
+        if (process) rc = m_context.WaitOneUpdateAll(m_depthGenerator);
+        else rc = m_depthGenerator.WaitAndUpdateData();
+        if (rc == XN_STATUS_EOF)
+        {
+            std::cout << "end of recording" << std::endl;
+            m_recordingEnded = true;
+            break;
+        }
         if (rc != XN_STATUS_OK)
         {
             std::cout << "Failed updating data: " << xnGetStatusString(rc) << std::endl;
             break;
         }
 
-        m_sessionManager.Update(&m_context);
+        qint64 wake = wakeTimer.nsecsElapsed();
+        XnUInt64 timestamp = m_depthGenerator.GetTimestamp();
+        if (lastWake >= 0 && timestamp > lastTimestamp)
+        {
+            updateFrameStatistics((wake - lastWake) / 1000000.0, (timestamp - lastTimestamp) / 1000.0);
+        }
+        lastWake = wake;
+        lastTimestamp = timestamp;
+        m_frameTime = timestamp / 1000000.0;
+
+        qint64 cpu = threadCpuTime();
+        if (lastIdle)
+        {
+            m_idleCpuSum += cpu - lastCpu;
+            m_idleWallSum += wake - lastWall;
+        }
+        else
+        {
+            m_activeCpuSum += cpu - lastCpu;
+            m_activeWallSum += wake - lastWall;
+        }
+        lastCpu = cpu;
+        lastWall = wake;
+        lastIdle = idle;
+
+        if (idle) m_statistics.idleFrames++;
+        if (!process)
+        {
+            m_statistics.skippedFrames++;
+            if (m_skipStartTime < 0.0) m_skipStartTime = m_frameTime;
+        }
+
+        if (m_engageTime >= 0.0 && !m_sessionActive && m_frameTime - m_engageTime > ENGAGE_TIMEOUT) m_engageTime = -1.0;
+
+        m_handUpdated = false;
+        if (process) m_sessionManager.Update(&m_context);
+
+        if (m_recovering) updateRecovery(m_frameTime);
+
+        if (process && m_acquisitionMode == AcquisitionNearestBlob && !m_sessionActive)
+        {
+            // same blob needs to stay on consecutive frames so that passing objects don't start a session
+            XnPoint3D focus;
+            if (findEngagementBlob(focus))
+            {
+                QVector3D movement(focus.X - m_blobCandidate.X, focus.Y - m_blobCandidate.Y, focus.Z - m_blobCandidate.Z);
+                if (m_blobFrames > 0 && movement.length() < BLOB_MAX_MOVEMENT) m_blobFrames++;
+                else m_blobFrames = 1;
+                if (m_blobFrames == 1 && m_engageTime < 0.0) m_engageTime = engageStartTime();
+                m_blobCandidate = focus;
+
+                if (m_blobFrames >= BLOB_STABLE_FRAMES)
+                {
+                    // starts hand tracking at the focus point like a focus gesture would
+                    m_sessionManager.ForceSession(focus);
+                    m_sessionActive = true;
+                    m_blobFrames = 0;
+                }
+            }
+            else
+            {
+                m_blobFrames = 0;
+            }
+        }
+
+        if (process) m_skipStartTime = -1.0;
+
+        // copied to the capture writer's queue, dropped if the writer has fallen behind
+        if (!m_captureFile.isEmpty()) m_capture.queueFrame(m_depthGenerator.GetDepthMap(), timestamp, m_handUpdated ? &m_handPosRealWorld : 0);
+    }
+
+    // capture stays open over a restart and is closed by the destructor
+    suspendTracking();
+
+    // partial period, so that the end of a recording is included
+    emitStatistics();
+}
 
-        static QMutex mutex;
-        mutex.lock();
-        quit = m_quit;
-        mutex.unlock();
+void AirCursor::start(Priority priority)
+{
+    {
+        QMutexLocker locker(&m_stateMutex);
+        m_quit.fetchAndStoreOrdered(0);
     }
+    QThread::start(priority);
 }
 
 void AirCursor::stop()
 {
-    static QMutex mutex;
-    QMutexLocker locker(&mutex);
-    m_quit = true;
+    QMutexLocker locker(&m_stateMutex);
+    m_quit.fetchAndStoreOrdered(1);
+    m_stateChanged.wakeAll();
 }
 
-void AirCursor::analyzeGrab()
+void AirCursor::pause()
 {
-    cvClearMemStorage(m_cvMemStorage);
+    QMutexLocker locker(&m_stateMutex);
+    m_paused.fetchAndStoreOrdered(1);
+    m_stateChanged.wakeAll();
+}
 
-    // get current depth map from Kinect
-    const XnDepthPixel* depthMap = m_depthGenerator.GetDepthMap();
+void AirCursor::resume()
+{
+    QMutexLocker locker(&m_stateMutex);
+    m_paused.fetchAndStoreOrdered(0);
+    m_stateChanged.wakeAll();
+}
+
+bool AirCursor::isPaused() const
+{
+    return m_paused.fetchAndAddOrdered(0) != 0;
+}
+
+void XN_CALLBACK_TYPE AirCursor::newDataCB(xn::ProductionNode& node, void* cxt)
+{
+    AirCursor* ac = (AirCursor*)cxt;
+    QMutexLocker locker(&ac->m_stateMutex);
+    ac->m_stateChanged.wakeAll();
+}
 
-    // convert 16bit openNI depth map to 8bit IplImage used in opencv processing
-    int origDepthIndex = 0;
-    char* depthPtr = m_iplDepthMap->imageData;
-    char* debugPtr = 0;
-    if (m_debugImageEnabled) debugPtr = m_iplDebugImage->imageData;
-    for (unsigned int y = 0; y < DEPTH_MAP_SIZE_Y; y++)
+// sleeps until the sensor has a new depth frame, woken by newDataCB() or by stop() and
+// pause() so they don't have to wait for the next frame. false if one of them interrupted it
+bool AirCursor::waitForFrame()
+{
+    QMutexLocker locker(&m_stateMutex);
+    while (!m_depthGenerator.IsNewDataAvailable())
     {
-        for (unsigned int x = 0; x < DEPTH_MAP_SIZE_X; x++)
-        {
-            // get current depth value from original depth map
-            short depth = depthMap[origDepthIndex];
+        if (m_quit.fetchAndAddOrdered(0) || m_paused.fetchAndAddOrdered(0)) return false;
+        m_stateChanged.wait(&m_stateMutex);
+    }
+    return true;
+}
 
-            // check that current value is in the allowed range determined by clipping distances,
-            // and if it is map it to range 0 - 255 so that 255 is the closest value
-            unsigned char pixel = 0;
-            if (depth >= NEAR_CLIPPING_DISTANCE && depth <= FAR_CLIPPING_DISTANCE)
-            {
-               depth -= NEAR_CLIPPING_DISTANCE;
-                    pixel = 255 - (255.0f * ((float)depth / (FAR_CLIPPING_DISTANCE - NEAR_CLIPPING_DISTANCE)));
-            }
-            else {
-                pixel = 0;
-            }
-            m_iplDepthMap->imageData[y * m_iplDepthMap->widthStep + x] = pixel;
-            *depthPtr = pixel;
+// ends the session and stops the sensor, context and generators stay initialized
+void AirCursor::suspendTracking()
+{
+    if (m_sessionActive) m_sessionManager.EndSession();
+    m_engageTime = -1.0;
+    m_skipStartTime = -1.0;
+    m_blobFrames = 0;
+    m_idleFrames = 0;
+    m_context.StopGeneratingAll();
+}
 
-            if (m_debugImageEnabled)
-            {
-                // init debug image with the same depth map
-                *(debugPtr + 0) = pixel;
-                *(debugPtr + 1) = pixel;
-                *(debugPtr + 2) = pixel;
-                debugPtr += 3;
-            }
-            origDepthIndex++;
-            depthPtr++;
+// an engagement seen on a processed frame may have started on the first frame skipped
+// before it, so the skip interval counts toward the wake latency
+qreal AirCursor::engageStartTime() const
+{
+    return m_skipStartTime >= 0.0 ? m_skipStartTime : m_frameTime;
+}
+
+// suspends tracking until resume() or stop(). returns false if tracking should end
+bool AirCursor::waitWhilePaused()
+{
+    suspendTracking();
+
+    {
+        QMutexLocker locker(&m_stateMutex);
+        while (m_paused.fetchAndAddOrdered(0) && !m_quit.fetchAndAddOrdered(0))
+        {
+            m_stateChanged.wait(&m_stateMutex);
         }
     }
+    if (m_quit.fetchAndAddOrdered(0)) return false;
+
+    XnStatus rc = m_context.StartGeneratingAll();
+    if (rc != XN_STATUS_OK)
+    {
+        std::cout << "data generating restart failed: " << xnGetStatusString(rc) << std::endl;
+        return false;
+    }
+    return true;
+}
 
-    // calculate region of interest corner points in real world coordinates
-    XnPoint3D rwPoint1 = m_handPosRealWorld;
-    rwPoint1.X -= HAND_ROI_SIZE_LEFT;
-    rwPoint1.Y += HAND_ROI_SIZE_UP;
-    XnPoint3D rwPoint2 = m_handPosRealWorld;
-    rwPoint2.X += HAND_ROI_SIZE_RIGHT;
-    rwPoint2.Y -= HAND_ROI_SIZE_DOWN;
+// grab analysis of one depth frame. without Debug the debug outputs are compiled out,
+// and FixedGeometry turns all frame indexing into constant strides
+template <bool Debug, class Geometry>
+void AirCursor::analyzeGrabFrame(const XnDepthPixel* depthMap)
+{
+    const Geometry g(m_iplDepthMap->width, m_iplDepthMap->height, m_iplDepthMap->widthStep);
+    const bool debugImage = Debug && m_debugImageEnabled;
+    const bool debugGeometry = Debug && m_debugGeometryEnabled;
+    const bool debugDepth = Debug && m_debugDepthEnabled;
 
-    // convert corner points to projective coordinates
-    XnPoint3D projPoint1, projPoint2;
-    m_depthGenerator.ConvertRealWorldToProjective(1, &rwPoint1, &projPoint1);
-    m_depthGenerator.ConvertRealWorldToProjective(1, &rwPoint2, &projPoint2);
+    cvClearMemStorage(m_cvMemStorage);
+    cvResetImageROI(m_iplDepthMap);
+
+    // real world points needed for this frame, converted to projective coordinates in one go:
+    // region of interest corners and defect min size point
+    XnPoint3D rwPoints[3];
+    rwPoints[0] = rwPoints[1] = rwPoints[2] = m_handPosRealWorld;
+    rwPoints[0].X -= HAND_ROI_SIZE_LEFT;
+    rwPoints[0].Y += HAND_ROI_SIZE_UP;
+    rwPoints[1].X += HAND_ROI_SIZE_RIGHT;
+    rwPoints[1].Y -= HAND_ROI_SIZE_DOWN;
+    rwPoints[2].Y += m_grabParameters.defectMinSize;
+
+    XnPoint3D projPoints[3];
+    m_projection.toProjective(rwPoints, projPoints, 3);
+    const XnPoint3D& projPoint1 = projPoints[0];
+    const XnPoint3D& projPoint2 = projPoints[1];
+    const XnPoint3D& projDefectSizePoint = projPoints[2];
 
     // round projected corner points to ints and clip them against the depth map
     int ROItopLeftX = qRound(projPoint1.X); int ROItopLeftY = qRound(projPoint1.Y);
     int ROIbottomRightX = qRound(projPoint2.X); int ROIbottomRightY = qRound(projPoint2.Y);
-    if (ROItopLeftX < 0) ROItopLeftX = 0; else if (ROItopLeftX > DEPTH_MAP_SIZE_X - 1) ROItopLeftX = DEPTH_MAP_SIZE_X - 1;
-    if (ROItopLeftY < 0) ROItopLeftY = 0; else if (ROItopLeftY > DEPTH_MAP_SIZE_Y - 1) ROItopLeftY = DEPTH_MAP_SIZE_Y - 1;
-    if (ROIbottomRightX < 0) ROIbottomRightX = 0; else if (ROIbottomRightX > DEPTH_MAP_SIZE_X - 1) ROIbottomRightX = DEPTH_MAP_SIZE_X - 1;
-    if (ROIbottomRightY < 0) ROIbottomRightY = 0; else if (ROIbottomRightY > DEPTH_MAP_SIZE_Y - 1) ROIbottomRightY = DEPTH_MAP_SIZE_Y - 1;
+    if (ROItopLeftX < 0) ROItopLeftX = 0; else if (ROItopLeftX > g.width() - 1) ROItopLeftX = g.width() - 1;
+    if (ROItopLeftY < 0) ROItopLeftY = 0; else if (ROItopLeftY > g.height() - 1) ROItopLeftY = g.height() - 1;
+    if (ROIbottomRightX < 0) ROIbottomRightX = 0; else if (ROIbottomRightX > g.width() - 1) ROIbottomRightX = g.width() - 1;
+    if (ROIbottomRightY < 0) ROIbottomRightY = 0; else if (ROIbottomRightY > g.height() - 1) ROIbottomRightY = g.height() - 1;
 
-    // set region of interest
     CvRect rect = cvRect(ROItopLeftX, ROItopLeftY, ROIbottomRightX - ROItopLeftX, ROIbottomRightY - ROItopLeftY);
+
+    // convert 16bit openNI depth map to 8bit IplImage used in opencv processing.
+    // rows of the region of interest also collect a histogram of the hand depth on the same pass
+    int histogram[256];
+    memset(histogram, 0, sizeof(histogram));
+    convertDepth(g, depthMap, (unsigned char*)m_iplDepthMap->imageData, rect, histogram);
+
+    // init debug images with the same depth map
+    if (debugImage)
+    {
+        cvMerge(m_iplDepthMap, m_iplDepthMap, m_iplDepthMap, 0, m_iplDebugImage);
+    }
+    if (debugDepth)
+    {
+        for (int y = 0; y < g.height(); y++)
+        {
+            memcpy(m_debugDepthImage.scanLine(y), m_iplDepthMap->imageData + y * g.stride(), g.width());
+        }
+    }
+
+    // set region of interest. contours are found relative to it
+    QPoint roiOffset(0, 0);
     if(rect.height > 0 && rect.width > 0)
     {
         cvSetImageROI(m_iplDepthMap, rect);
-        if (m_debugImageEnabled) cvSetImageROI(m_iplDebugImage, rect);
+        if (debugImage) cvSetImageROI(m_iplDebugImage, rect);
+        roiOffset = QPoint(rect.x, rect.y);
+
+        if (m_depthFilters & (FilterHoleFill | FilterMedian)) filterDepth();
     }
 
-    // use depth threshold to isolate hand
-    // as a center point of thresholding, it seems that it's better to use a point bit below
-    // the point Nite gives as the hand point
-    XnPoint3D rwThresholdPoint = m_handPosRealWorld; rwThresholdPoint.Y -= 30;
-    XnPoint3D projThresholdPoint;
-    m_depthGenerator.ConvertRealWorldToProjective(1, &rwThresholdPoint, &projThresholdPoint);
-    int lowerBound = (unsigned char)m_iplDepthMap->imageData[(int)projThresholdPoint.Y * DEPTH_MAP_SIZE_X + (int)projThresholdPoint.X] - DEPTH_THRESHOLD;
+    AirCursorDebugGeometry geometry;
+    if (debugGeometry)
+    {
+        geometry.roi = QRect(ROItopLeftX, ROItopLeftY, ROIbottomRightX - ROItopLeftX, ROIbottomRightY - ROItopLeftY);
+        geometry.handPoint = QPoint(m_handPosProjected.X, m_handPosProjected.Y);
+        geometry.handDistance = m_handPosRealWorld.Z;
+        geometry.grabbing = m_grabbing;
+    }
+
+    // use depth threshold to isolate hand. hand depth is the most common depth in the region of
+    // interest near the distance Nite gives, so single noisy or missing pixels don't affect it
+    int handPixel = handDepthPixel(histogram, depthToPixel(qRound(m_handPosRealWorld.Z)));
+    int lowerBound = handPixel - DEPTH_THRESHOLD;
     if (lowerBound < 0) lowerBound = 0;
     cvThreshold( m_iplDepthMap, m_iplDepthMap, lowerBound, 255, CV_THRESH_BINARY );
+    if ((m_depthFilters & FilterMorphology) && rect.height > 0 && rect.width > 0) filterMask();
 
     // color used for drawing the hand in the debug image, green for normal and red for grab.
     // color lags one frame from actual grab status but in practice that shouldn't be too big of a problem
@@ -441,49 +1459,42 @@ void AirCursor::analyzeGrab()
     }
 
     // go through the ROI and paint hand on debug image with current grab status color
-    if (m_debugImageEnabled)
+    if (debugImage)
     {
-        // index of first pixel in the ROI
-        int startIndex = ROItopLeftY * m_iplDepthMap->widthStep + ROItopLeftX;
-
-        depthPtr = &(m_iplDepthMap->imageData[startIndex]);
-        debugPtr = &(m_iplDebugImage->imageData[startIndex * 3]);
-
-        // how much index needs to increase when moving to next line
-        int vertInc = m_iplDepthMap->widthStep - (ROIbottomRightX - ROItopLeftX);
-
-        for (int y = ROItopLeftY; y < ROIbottomRightY; y++)
-        {
-            for (int x = ROItopLeftX; x < ROIbottomRightX; x++)
-            {
-                if((unsigned char)*depthPtr > 0)
-                {
-                    *(debugPtr + 0) = rCol / 2;
-                    *(debugPtr + 1) = gCol / 2;
-                    *(debugPtr + 2) = bCol / 2;
-                }
-
-                // next pixel
-                depthPtr++;
-                debugPtr += 3;
-            }
+        paintHand(g, (const unsigned char*)m_iplDepthMap->imageData, (unsigned char*)m_iplDebugImage->imageData,
+                  m_iplDebugImage->widthStep, rect, rCol / 2, gCol / 2, bCol / 2);
+    }
 
-            // next line
-            depthPtr += vertInc;
-            debugPtr += vertInc * 3;
-        }
+    // go through the ROI and set hand pixels to the hand mask, viewer does the coloring
+    if (debugDepth)
+    {
+        m_debugHandMask.fill(0);
+        packHandMask(g, (const unsigned char*)m_iplDepthMap->imageData, m_debugHandMask.bits(), m_debugHandMask.bytesPerLine(), rect);
     }
 
     // find contours in the hand and draw them on debug image
     CvSeq* contours = 0;
     cvFindContours(m_iplDepthMap, m_cvMemStorage, &contours, sizeof(CvContour));
-    if (m_debugImageEnabled)
+    if (debugImage)
     {
         if(contours)
         {
             cvDrawContours(m_iplDebugImage, contours, cvScalar(rCol, gCol , bCol), cvScalar(rCol, gCol, bCol), 1);
         }
     }
+    if (debugGeometry)
+    {
+        for(CvSeq* currCont = contours; currCont != 0; currCont = currCont->h_next)
+        {
+            QPolygon polygon(currCont->total);
+            for (int i = 0; i < currCont->total; i++)
+            {
+                CvPoint* p = CV_GET_SEQ_ELEM(CvPoint, currCont, i);
+                polygon[i] = QPoint(p->x, p->y) + roiOffset;
+            }
+            geometry.contours.push_back(polygon);
+        }
+    }
 
     // go through contours and search for the biggest one
     CvSeq* biggestContour = 0;
@@ -507,14 +1518,32 @@ void AirCursor::analyzeGrab()
         // calculate convex hull of the biggest contour found which is hopefully the hand
         CvSeq* hulls = cvConvexHull2(biggestContour, m_cvMemStorage, CV_CLOCKWISE, 0);
 
-        if (m_debugImageEnabled)
+        if (debugImage || debugGeometry)
         {
-            // calculate convex hull and return it in a different form.
-            // only required for drawing
-            CvSeq* hulls2 = cvConvexHull2(biggestContour, m_cvMemStorage, CV_CLOCKWISE, 1);
+            // hull is returned as pointers to the contour points, collect the points for drawing
+            // so that the hull doesn't need to be calculated again in point form
+            int hullSize = hulls->total;
+            CvPoint* hullPoints = (CvPoint*)malloc(sizeof(CvPoint) * hullSize);
+            for (int i = 0; i < hullSize; i++)
+            {
+                hullPoints[i] = **CV_GET_SEQ_ELEM(CvPoint*, hulls, i);
+            }
+
+            if (debugImage && hullSize > 0)
+            {
+                // draw the convex hull
+                cvPolyLine(m_iplDebugImage, &hullPoints, &hullSize, 1, 1, cvScalar(rCol, gCol, bCol));
+            }
+            if (debugGeometry)
+            {
+                geometry.hull.resize(hullSize);
+                for (int i = 0; i < hullSize; i++)
+                {
+                    geometry.hull[i] = QPoint(hullPoints[i].x, hullPoints[i].y) + roiOffset;
+                }
+            }
 
-            // draw the convex hull
-            cvDrawContours(m_iplDebugImage, hulls2, cvScalar(rCol, gCol , bCol), cvScalar(rCol, gCol, bCol), 1);
+            free(hullPoints);
         }
 
         // calculate convexity defects of hand's convex hull
@@ -525,13 +1554,9 @@ void AirCursor::analyzeGrab()
         if (numOfDefects > 0)
         {
             // calculate defect min size in projective coordinates.
-            // this is done using a vector from current hand position to a point DEFECT_MIN_SIZE amount above it.
+            // this is done using a vector from current hand position to a point defect min size amount above it.
             // that vector is converted to projective coordinates and it's length is calculated.
-            XnPoint3D rwTempPoint = m_handPosRealWorld;
-            rwTempPoint.Y += DEFECT_MIN_SIZE;
-            XnPoint3D projTempPoint;
-            m_depthGenerator.ConvertRealWorldToProjective(1, &rwTempPoint, &projTempPoint);
-            int defectMinSizeProj = m_handPosProjected.Y - projTempPoint.Y;
+            int defectMinSizeProj = m_handPosProjected.Y - projDefectSizePoint.Y;
 
             // convert opencv seq to array
             CvConvexityDefect* defectArray;defectArray = (CvConvexityDefect*)malloc(sizeof(CvConvexityDefect) * numOfDefects);
@@ -547,20 +1572,26 @@ void AirCursor::analyzeGrab()
 
                numOfValidDefects++;
 
-               if (m_debugImageEnabled)
+               if (debugImage)
                {
                    // draw blue point to defect
                    cvCircle(m_iplDebugImage, *(defectArray[i].depth_point), 5, cvScalar(0, 0, 255), -1);
                    cvCircle(m_iplDebugImage, *(defectArray[i].start), 5, cvScalar(0, 0, 255), -1);
                    cvCircle(m_iplDebugImage, *(defectArray[i].end), 5, cvScalar(0, 0, 255), -1);
                }
+               if (debugGeometry)
+               {
+                   geometry.defects << QPoint(defectArray[i].depth_point->x, defectArray[i].depth_point->y) + roiOffset
+                                    << QPoint(defectArray[i].start->x, defectArray[i].start->y) + roiOffset
+                                    << QPoint(defectArray[i].end->x, defectArray[i].end->y) + roiOffset;
+               }
             }
 
             free(defectArray);
         }
     }
 
-    if (m_debugImageEnabled)
+    if (debugImage)
     {
         cvResetImageROI(m_iplDebugImage);
 
@@ -584,71 +1615,171 @@ void AirCursor::analyzeGrab()
         m_currentGrab = false;
     }
 
-    if (m_debugImageEnabled)
+    if (debugImage)
     {
         // debug strings
         QList<QString> debugStrings;
-        debugStrings.push_back(QString("hand distance: " + QString::number(m_handPosRealWorld.Z) + " mm").toStdString().c_str());
-        debugStrings.push_back(QString("defects: " + QString::number(numOfValidDefects)).toStdString().c_str());
+        debugStrings.push_back(QString("hand distance: %1 mm").arg(m_handPosRealWorld.Z));
+        debugStrings.push_back(QString("defects: %1").arg(numOfValidDefects));
 
         // convert iplDebugImage to QImage
         char* scanLinePtr = m_iplDebugImage->imageData;
-        for (int y = 0;y < DEPTH_MAP_SIZE_Y; y++) {
-            memcpy(m_debugImage->scanLine(y), scanLinePtr, DEPTH_MAP_SIZE_X * 3);
-            scanLinePtr += DEPTH_MAP_SIZE_X * 3;
+        for (int y = 0;y < g.height(); y++) {
+            memcpy(m_debugImage->scanLine(y), scanLinePtr, g.width() * 3);
+            scanLinePtr += m_iplDebugImage->widthStep;
         }
 
         emit debugUpdate(*m_debugImage, debugStrings);
     }
+
+    if (debugGeometry)
+    {
+        geometry.numOfDefects = numOfValidDefects;
+        emit debugGeometryUpdate(geometry);
+    }
+
+    if (debugDepth)
+    {
+        emit debugDepthUpdate(m_debugDepthImage, m_debugHandMask, m_grabbing);
+    }
 }
 
-// update grab state based on running grab value
-void AirCursor::updateState()
+// finds the nearest hand sized blob in the engagement range from a sparse scan of the depth map.
+// returns its center in real world coordinates
+bool AirCursor::findEngagementBlob(XnPoint3D& focus)
 {
-    m_runningGrab = GRAB_SMOOTHING_FACTOR * m_runningGrab + (1.0 - GRAB_SMOOTHING_FACTOR) * (float)m_currentGrab;
+    const XnDepthPixel* depthMap = m_depthGenerator.GetDepthMap();
+    const int width = m_projection.xRes();
+    const int height = m_projection.yRes();
 
-    if (!m_grabbing)
+    int nearest = m_engagementFar + 1;
+    int nearestX = -1, nearestY = -1;
+    for (int y = 0; y < height; y += BLOB_SCAN_STEP)
     {
-        if (m_runningGrab > (0.5 + GRAB_STATE_CHANGE_THRESHOLD))
+        const XnDepthPixel* row = depthMap + y * width;
+        for (int x = 0; x < width; x += BLOB_SCAN_STEP)
         {
-            m_grabbing = true;
-            emit grab(m_handPosRealWorld.X, m_handPosRealWorld.Y, m_handPosRealWorld.Z);
+            int depth = row[x];
+            if (depth >= m_engagementNear && depth < nearest)
+            {
+                nearest = depth;
+                nearestX = x;
+                nearestY = y;
+            }
         }
     }
-    else
+    if (nearestX < 0) return false;
+
+    // blob box half size in pixels at the nearest depth
+    XnPoint3D edge;
+    edge.X = nearestX; edge.Y = nearestY; edge.Z = nearest;
+    edge = m_projection.toRealWorld(edge);
+    edge.X += BLOB_HALF_SIZE;
+    int halfSize = qRound(m_projection.toProjective(edge).X) - nearestX;
+
+    // count blob samples in the box and in a box twice as large. a hand has little at the
+    // same depth around it, while a body or a wall continues past the box
+    int inner = 0, outer = 0;
+    qint64 sumX = 0, sumY = 0, sumZ = 0;
+    int outerHalfSize = halfSize * 2;
+    for (int y = qMax(0, nearestY - outerHalfSize); y <= qMin(height - 1, nearestY + outerHalfSize); y += BLOB_SCAN_STEP)
     {
-        if (m_runningGrab < (0.5 - GRAB_STATE_CHANGE_THRESHOLD))
+        const XnDepthPixel* row = depthMap + y * width;
+        for (int x = qMax(0, nearestX - outerHalfSize); x <= qMin(width - 1, nearestX + outerHalfSize); x += BLOB_SCAN_STEP)
         {
-            m_grabbing = false;
-            emit grabRelease(m_handPosRealWorld.X, m_handPosRealWorld.Y, m_handPosRealWorld.Z);
+            int depth = row[x];
+            if (depth < nearest || depth > nearest + BLOB_DEPTH) continue;
+
+            outer++;
+            if (qAbs(x - nearestX) <= halfSize && qAbs(y - nearestY) <= halfSize)
+            {
+                inner++;
+                sumX += x; sumY += y; sumZ += depth;
+            }
         }
     }
+    if (inner < BLOB_MIN_SAMPLES || outer - inner > inner / 2) return false;
+
+    XnPoint3D center;
+    center.X = (float)sumX / inner;
+    center.Y = (float)sumY / inner;
+    center.Z = (float)sumZ / inner;
+    focus = m_projection.toRealWorld(center);
+    return true;
 }
 
-// add new raw hand position and update smoothed position
-void AirCursor::newHandPoint(qreal x, qreal y, qreal z)
+// tries to restart tracking of a lost hand where it would be if it kept moving,
+// and gives up when the recovery window has passed
+void AirCursor::updateRecovery(qreal time)
 {
-    XnPoint3D hp;
-    hp.X = x; hp.Y = y; hp.Z = z;
-    while (m_handPoints.size() > NUM_OF_SMOOTHING_POINTS - 1) m_handPoints.pop_front();
-    m_handPoints.push_back(hp);
+    qreal elapsed = time - m_lostTime;
+    if (elapsed > m_recoveryWindow)
+    {
+        m_recovering = false;
+        m_listeners.handDestroy(time);
+        return;
+    }
+
+    if (m_recoveryFrames++ % RECOVERY_ATTEMPT_FRAMES != 0) return;
+
+    qreal prediction = qMin(qMax(elapsed, (qreal)0.0), RECOVERY_PREDICTION_TIME);
+    XnPoint3D predicted = m_handPosRealWorld;
+    predicted.X += m_handVelocity.X * prediction;
+    predicted.Y += m_handVelocity.Y * prediction;
+    predicted.Z += m_handVelocity.Z * prediction;
+
+    // handCreateCB is called if a hand is found there
+    m_handsGenerator.StartTracking(predicted);
+}
 
-    XnPoint3D cumulHp;
-    cumulHp.X = cumulHp.Y = cumulHp.Z = 0;
-    for (unsigned int i = 0; i < m_handPoints.size(); i++)
+// filters the depth in the region of interest before thresholding.
+// opencv's 8bit morphology and median use simd so these stay cheap on the small roi
+void AirCursor::filterDepth()
+{
+    qint64 start = m_analysisTimer.nsecsElapsed();
+
+    if (m_depthFilters & FilterHoleFill)
+    {
+        // closing raises zero dropouts to the surrounding depth without growing the hand outline
+        cvMorphologyEx(m_iplDepthMap, m_iplDepthMap, 0, 0, CV_MOP_CLOSE, 1);
+    }
+    if (m_depthFilters & FilterMedian)
     {
-        cumulHp.X += m_handPoints[i].X;
-        cumulHp.Y += m_handPoints[i].Y;
-        cumulHp.Z += m_handPoints[i].Z;
+        cvSetImageROI(m_iplFilterTemp, cvGetImageROI(m_iplDepthMap));
+        cvSmooth(m_iplDepthMap, m_iplFilterTemp, CV_MEDIAN, 3);
+        cvCopy(m_iplFilterTemp, m_iplDepthMap);
     }
 
-    m_handPosSmooth.X = cumulHp.X / m_handPoints.size();
-    m_handPosSmooth.Y = cumulHp.Y / m_handPoints.size();
-    m_handPosSmooth.Z = cumulHp.Z / m_handPoints.size();
+    m_depthFilterSum += (m_analysisTimer.nsecsElapsed() - start) / 1000000.0;
 }
 
+// removes single pixel speckle and fills pinholes in the thresholded hand mask
+void AirCursor::filterMask()
+{
+    qint64 start = m_analysisTimer.nsecsElapsed();
 
+    cvMorphologyEx(m_iplDepthMap, m_iplDepthMap, 0, 0, CV_MOP_OPEN, 1);
+    cvMorphologyEx(m_iplDepthMap, m_iplDepthMap, 0, 0, CV_MOP_CLOSE, 1);
 
+    m_depthFilterSum += (m_analysisTimer.nsecsElapsed() - start) / 1000000.0;
+}
 
+// update grab state based on running grab value
+void AirCursor::updateState()
+{
+    int change = updateGrabState(m_runningGrab, m_grabbing, m_currentGrab,
+                                 m_grabParameters.smoothingFactor, m_grabParameters.stateChangeThreshold);
+    if (change == 0) return;
 
+    m_statistics.grabTransitions++;
+    if (change > 0) m_listeners.grab(handFrame(m_handPosRealWorld));
+    else m_listeners.grabRelease(handFrame(m_handPosRealWorld));
+}
 
+// add new raw hand position and update smoothed position
+void AirCursor::newHandPoint(qreal x, qreal y, qreal z)
+{
+    XnPoint3D hp;
+    hp.X = x; hp.Y = y; hp.Z = z;
+    m_handPosSmooth = smoothHandPoint(m_handPoints, hp, NUM_OF_SMOOTHING_POINTS);
+}
@@ -5,7 +5,11 @@
     Quick instructions:
     
     1. Make sure dependencies (OpenNI, Nite, OpenCV) are included in your .pro file
-    2. Add aircursor.h and aircursor.cpp to your project
+    2. Add aircursor.h, aircursor.cpp, gesturedetector.h, gesturedetector.cpp,
+       handtrajectory.h, handtrajectory.cpp, depthprojection.h,
+       aircursorkernels.h, depthcodec.h, depthcodec.cpp, depthcapture.h,
+       depthcapture.cpp, aircursorlistener.h and aircursorlistener.cpp to
+       your project
     3. Instantiate AirCursor class in your code
     4. Call AirCursor::init()
     5. Connect AirCursor signals to your QObjects
@@ -17,7 +21,15 @@
 
 #include <QThread>
 #include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
 #include <QImage>
+#include <QPolygon>
+#include <QRect>
+#include <QMetaType>
+#include <QStringList>
+#include <QMatrix4x4>
+#include <QElapsedTimer>
 #include <iostream>
 
 #include <XnOpenNI.h>
@@ -25,19 +37,286 @@
 
 #include <cv.h>
 
+#include "gesturedetector.h"
+#include "handtrajectory.h"
+#include "depthprojection.h"
+#include "depthcapture.h"
+#include "aircursorlistener.h"
+
+// geometry of one analyzed frame for viewers that draw debug overlays themselves.
+// all points are in depth map (640x480 projective) coordinates
+struct AirCursorDebugGeometry
+{
+    AirCursorDebugGeometry() : handDistance(0.0), numOfDefects(0), grabbing(false) {}
+
+    // all contours found in the region of interest
+    QList<QPolygon> contours;
+
+    // convex hull of the biggest contour
+    QPolygon hull;
+
+    // depth, start and end point of each valid convexity defect
+    QPolygon defects;
+
+    QRect roi;
+    QPoint handPoint;
+
+    qreal handDistance;
+    int numOfDefects;
+    bool grabbing;
+};
+
+Q_DECLARE_METATYPE(AirCursorDebugGeometry)
+
+// tracker thread timing collected over a reporting period, times are in milliseconds
+struct AirCursorStatistics
+{
+    AirCursorStatistics() : frames(0), frameInterval(0.0), schedulingJitter(0.0), maxSchedulingDelay(0.0),
+        analyzedFrames(0), grabAnalysisTime(0.0), depthFilterTime(0.0), grabTransitions(0),
+        idleFrames(0), skippedFrames(0), activeCpuLoad(0.0), idleCpuLoad(0.0), wakeups(0), wakeLatency(0.0),
+        capturedFrames(0), droppedCaptureFrames(0), captureTime(0.0), captureRatio(0.0) {}
+
+    // frames processed during the period
+    quint32 frames;
+
+    // mean time between consecutive wakeups from WaitOneUpdateAll
+    qreal frameInterval;
+
+    // standard deviation and maximum of the difference between wakeup interval
+    // and the sensor's frame timestamp interval, i.e. delay added by scheduling
+    qreal schedulingJitter;
+    qreal maxSchedulingDelay;
+
+    // hand frames analyzed for grab, mean time of the whole analysis and of the depth
+    // filters included in it
+    quint32 analyzedFrames;
+    qreal grabAnalysisTime;
+    qreal depthFilterTime;
+
+    // grab and release signals emitted during the period
+    quint32 grabTransitions;
+
+    // frames without a session, and how many of them only updated the depth
+    quint32 idleFrames;
+    quint32 skippedFrames;
+
+    // tracker thread cpu time per wall time with and without a session, 1.0 is one core.
+    // only measured on linux
+    qreal activeCpuLoad;
+    qreal idleCpuLoad;
+
+    // sessions started and mean time from the start of the focus gesture or
+    // nearest blob to the session start, counted from the first skipped frame
+    // when the start was seen right after skipping
+    quint32 wakeups;
+    qreal wakeLatency;
+
+    // frames written to the depth capture and frames dropped because its writer
+    // thread fell behind, mean time to compress and write one on the writer thread
+    // and raw size per compressed size
+    quint32 capturedFrames;
+    quint32 droppedCaptureFrames;
+    qreal captureTime;
+    qreal captureRatio;
+};
+
+Q_DECLARE_METATYPE(AirCursorStatistics)
+
 class AirCursor : public QThread
 {
     Q_OBJECT
 public:
 
+    // what kind of debug data is emitted for each analyzed frame, can be combined
+    enum DebugMode
+    {
+        DebugNone = 0x0,        // no debug data
+        DebugImage = 0x1,       // rendered rgb image and strings, debugUpdate()
+        DebugGeometry = 0x2,    // geometry and numeric stats only, debugGeometryUpdate()
+        DebugDepth = 0x4        // 8bit depth and 1bit hand mask, debugDepthUpdate()
+    };
+    Q_DECLARE_FLAGS(DebugModes, DebugMode)
+
+    // optional filters run on the hand region of interest before grab analysis, can be combined.
+    // hole fill and median work on the depth, morphology on the thresholded hand mask
+    enum DepthFilter
+    {
+        FilterNone = 0x0,
+        FilterHoleFill = 0x1,   // 3x3 closing, fills dropouts inside the hand
+        FilterMedian = 0x2,     // 3x3 median, removes speckle along the edges
+        FilterMorphology = 0x4  // 3x3 opening and closing of the mask
+    };
+    Q_DECLARE_FLAGS(DepthFilters, DepthFilter)
+
+    // how recordings are played back. fastest plays each frame once as soon as the previous
+    // one is processed and ends the thread at the end of the recording
+    enum PlaybackMode
+    {
+        PlaybackRealTime,
+        PlaybackFastest
+    };
+
+    // grab detection tuning, defaults are the constants in aircursor.cpp
+    struct GrabParameters
+    {
+        GrabParameters();
+
+        // how much running grab value is affected by new values
+        qreal smoothingFactor;
+
+        // how much running grab value needs to shift before grab status is changed
+        qreal stateChangeThreshold;
+
+        // min size for defects to be counted, in mm
+        int defectMinSize;
+    };
+
+    // how a hand tracking session is started
+    enum AcquisitionMode
+    {
+        AcquisitionFocusGesture,    // nite wave or click focus gesture
+        AcquisitionNearestBlob      // nearest hand sized blob in the engagement range, no gesture needed
+    };
+
+    // what the tracker does while there's no session. skipping frames updates only the depth
+    // on most frames, nite and acquisition run on every nth frame until a focus gesture or
+    // a blob is seen
+    enum IdlePolicy
+    {
+        IdleFullRate,
+        IdleSkipFrames
+    };
+
+    // which detectors emit swipe and push signals
+    enum GestureEngine
+    {
+        NiteGestures,   // nite push and swipe detectors on the session manager
+        NativeGestures  // GestureDetector running on the hand positions
+    };
+
     explicit AirCursor(QObject *parent = 0);
     ~AirCursor();
 
+    // names of the depth sensors OpenNI finds, index in this list is used with setDevice()
+    static QStringList availableDevices();
+
+    // sensor selection, one of these can be called before init(). by default the first
+    // sensor found is used. recording is an .oni file played back instead of a sensor
+    void setDevice(int index);
+    void setRecording(const QString& fileName, PlaybackMode mode = PlaybackRealTime);
+
+    // whether the tracker thread last finished at the end of the recording, as opposed
+    // to a read error or stop(). valid after wait()
+    bool recordingEnded() const { return m_recordingEnded; }
+
+    // writes every depth frame with the tracked hand point to a compressed depth capture
+    // file while running, see depthcapture.h. frames are compressed and written on a
+    // separate thread and dropped if it falls behind. set before init(), empty for no capture
+    void setCapture(const QString& fileName);
+
+    // filters used before grab analysis, set before init()
+    void setDepthFilters(DepthFilters filters);
+
+    // session acquisition and the depth range in mm where nearest blob acquisition looks for
+    // a hand. focus gestures start sessions in both modes. set before start()
+    void setAcquisitionMode(AcquisitionMode mode);
+    void setEngagementRange(int nearDistance, int farDistance);
+
+    // how long in seconds a lost hand is searched for near its predicted position before
+    // handDestroy is emitted. 0 emits handDestroy right away
+    void setRecoveryWindow(qreal seconds);
+
+    // idle policy and every how manyth frame is processed when skipping, set before start()
+    void setIdlePolicy(IdlePolicy policy, int frameInterval = 3);
+
+    // prepares grab analysis without a sensor, for feeding depth frames to processFrame().
+    // use instead of init()
+    bool initProcessing(DebugModes debugModes = DebugNone, int width = 640, int height = 480);
+
+    // analyzes one depth frame with hand at given real world position and updates grab state
+    // like tracked frames do, emitting grab signals and debug data. returns grab state
+    bool processFrame(const XnDepthPixel* depthMap, const XnPoint3D& handPosition);
+
+    // uses the generic analysis pipeline even when a specialized one exists, for comparing
+    // them. set before init()
+    void setGenericPipeline(bool generic);
+
+    // grab detection parameters, set before start()
+    void setGrabParameters(const GrabParameters& parameters);
+
+    // transform from this sensor's coordinates to a coordinate space shared by several
+    // sensors. applied to all emitted positions and the trajectory, set before start()
+    void setTransform(const QMatrix4x4& transform);
+
+    // cpus the tracker thread is allowed to run on, empty for no restriction. set before start()
+    void setCpuAffinity(const QList<int>& cpus);
+
+    // real time scheduling of the tracker thread, usually needs root or CAP_SYS_NICE.
+    // with default policy the thread runs with the priority given to start(). set before start()
+    enum SchedulingPolicy
+    {
+        SchedulingDefault,
+        SchedulingFifo,
+        SchedulingRoundRobin
+    };
+    void setScheduling(SchedulingPolicy policy, int priority);
+
+    // locks all process memory including the working buffers to RAM so that
+    // the tracker never waits for page faults. set before start()
+    void setLockMemory(bool lock);
+
+    // gesture engine and native gesture thresholds, engine needs to be set before init()
+    // and thresholds before start()
+    void setGestureEngine(GestureEngine engine);
+    void setGestureSettings(const GestureDetector::Settings& settings);
+
+    // position history of the most recently created hand, or of the hand with given id.
+    // can be read from any thread while tracking is running
+    const HandTrajectory& trajectory() const;
+    const HandTrajectory* trajectory(quint32 handId) const;
+
+    // direct listeners called synchronously on the tracker thread, see aircursorlistener.h.
+    // adding and removing are lock free and can be done while tracking. the signals
+    // take one of the AirCursorListenerList::MAX_LISTENERS slots
+    bool addListener(AirCursorListener* listener);
+    void removeListener(AirCursorListener* listener);
+
+    // the listener that emits this air cursor's signals, for delivering events from
+    // another source through them
+    AirCursorListener* signalListener() { return &m_signalListener; }
+
+    // depth camera projection, valid after init
+    const DepthProjection& projection() const { return m_projection; }
+
     bool init(bool makeDebugImage = false);
+    bool init(DebugModes debugModes);
+
+    // a single mode would otherwise convert to bool and pick the debug image overload
+    bool init(DebugMode debugMode) { return init(DebugModes(debugMode)); }
+
+    // runs init on the tracker thread and starts tracking when it's done, so the caller
+    // isn't blocked for the seconds opening the sensor takes. progress and the result come
+    // with initProgress(), initReady() and initFailed(). use instead of init() and start()
+    void initAsync(DebugModes debugModes = DebugNone, Priority priority = InheritPriority);
 
     virtual void run();
+
+    // ends tracking right away, also from a pause or while waiting for a frame. wait()
+    // returns when the tracker thread has finished, after which start() restarts tracking
+    // with the same sensor without repeating init()
     void stop();
 
+    // suspends tracking without releasing the sensor. the session is ended and the sensor
+    // stops streaming, but context and generators stay initialized so resume() restarts
+    // tracking in milliseconds instead of repeating init(). can be called from any thread
+    void pause();
+    void resume();
+    bool isPaused() const;
+
+public slots:
+    // clears an earlier stop() before starting the tracker thread
+    void start(Priority priority = InheritPriority);
+
 signals:
     // most of these signals are straight equivalents of openni/nite callbacks
 
@@ -45,6 +324,11 @@ signals:
     void handCreate(qreal x, qreal y, qreal z, qreal time);
     void handDestroy(qreal time);
 
+    // emitted when tracking of the hand is lost and a recovery window starts. recovered hand
+    // keeps the lost hand's trajectory and grab state, otherwise handDestroy follows
+    void handLost(qreal time);
+    void handRecovered(qreal x, qreal y, qreal z, qreal time);
+
     // emitted when full focus gesture is detected
     void gestureRecognized(QString gestureStr);
 
@@ -72,17 +356,90 @@ signals:
     // emitted when debug image is updated
     void debugUpdate(QImage image, QList<QString> strings);
 
+    // emitted instead of debug image in geometry debug mode
+    void debugGeometryUpdate(AirCursorDebugGeometry geometry);
+
+    // emitted in depth debug mode. depth is an indexed 8bit image with grayscale color table
+    // and hand mask a 1bit image of the thresholded hand, viewer sets the mask colors
+    void debugDepthUpdate(QImage depth, QImage handMask, bool grabbing);
+
     // emitted when swipe gesture is detected
     void swipeUp(qreal velocity, qreal angle);
     void swipeDown(qreal velocity, qreal angle);
     void swipeLeft(qreal velocity, qreal angle);
     void swipeRight(qreal velocity, qreal angle);
 
+    // emitted periodically with tracker thread timing
+    void statisticsUpdate(AirCursorStatistics statistics);
+
+    // emitted by init() and initAsync() after each init phase with the phase number, the
+    // number of phases and the time the phase took in ms: context, depth, gestures, hands,
+    // session, start and analysis
+    void initProgress(QString phase, int step, int steps, qreal time);
+
+    // emitted when init has finished with the total time in ms, or with the failed phase
+    void initReady(qreal time);
+    void initFailed(QString phase);
+
+    // emitted after each natively detected gesture with the time in seconds
+    // from the start of the movement to the detection
+    void gestureLatency(QString gestureStr, qreal latency);
+
 private:
 
+    // emits the air cursor's signals for each event, the first listener of every air cursor
+    class SignalListener : public AirCursorListener
+    {
+    public:
+        explicit SignalListener(AirCursor* ac) : m_ac(ac) {}
+
+        void handCreate(const AirCursorHandFrame& frame);
+        void handUpdate(const AirCursorHandFrame& frame);
+        void handDestroy(qreal time);
+        void handLost(qreal time);
+        void handRecovered(const AirCursorHandFrame& frame);
+        void handTooClose();
+        void handTooFar();
+        void grab(const AirCursorHandFrame& frame);
+        void grabRelease(const AirCursorHandFrame& frame);
+        void push(const AirCursorHandFrame& frame, qreal velocity, qreal angle);
+        void swipeUp(qreal velocity, qreal angle);
+        void swipeDown(qreal velocity, qreal angle);
+        void swipeLeft(qreal velocity, qreal angle);
+        void swipeRight(qreal velocity, qreal angle);
+        void gestureRecognized(const QString& gesture);
+        void gestureProcess(const QString& gesture);
+        void sessionStart();
+        void sessionEnd();
+
+    private:
+        AirCursor* m_ac;
+    };
+
+    AirCursorHandFrame handFrame(const XnPoint3D& position) const;
+
     void analyzeGrab();
+    bool initSensor();
+    void nextInitPhase(const char* phase);
+    bool failInit();
+    bool waitForFrame();
+    bool waitWhilePaused();
+    void suspendTracking();
+    template <bool Debug, class Geometry> void analyzeGrabFrame(const XnDepthPixel* depthMap);
+    void initAnalysis();
     void updateState();
     void newHandPoint(qreal x, qreal y, qreal z);
+    int trajectoryIndex(quint32 handId) const;
+    XnPoint3D transformed(const XnPoint3D& point) const;
+    bool createDepthGenerator();
+    void applyThreadSettings();
+    void updateFrameStatistics(qreal wakeInterval, qreal frameInterval);
+    void emitStatistics();
+    void filterDepth();
+    void filterMask();
+    bool findEngagementBlob(XnPoint3D& focus);
+    qreal engageStartTime() const;
+    void updateRecovery(qreal time);
 
     // callbacks
     static void XN_CALLBACK_TYPE gestureRecognizedCB(xn::GestureGenerator& generator,
@@ -107,6 +464,9 @@ private:
 
     static void XN_CALLBACK_TYPE sessionEndCB(void* UserCxt);
 
+    // wakes the tracker waiting for a frame, called from the OpenNI device thread
+    static void XN_CALLBACK_TYPE newDataCB(xn::ProductionNode& node, void* cxt);
+
     static void XN_CALLBACK_TYPE pushCB(XnFloat fVelocity, XnFloat fAngle, void *UserCxt);
 
     static void XN_CALLBACK_TYPE swipeUpCB(XnFloat fVelocity, XnFloat fAngle, void* cxt);
@@ -116,19 +476,105 @@ private:
 
     QList<XnPoint3D> m_handPoints;
 
+    // position history for each tracked hand
+    static const int MAX_TRACKED_HANDS = 4;
+    HandTrajectory m_trajectories[MAX_TRACKED_HANDS];
+    int m_nextTrajectory;
+    mutable QAtomicInt m_currentTrajectory;
+
     xn::Context m_context;
+    xn::Player m_player;
+
+    int m_deviceIndex;
+    QString m_recording;
+    PlaybackMode m_playbackMode;
+    bool m_recordingEnded;
+
+    QString m_captureFile;
+    DepthCaptureWriter m_capture;
+
+    // whether a hand point was updated on the current frame, for the capture
+    bool m_handUpdated;
+
+    QMatrix4x4 m_transform;
+    bool m_transformEnabled;
+
+    QList<int> m_cpuAffinity;
+    SchedulingPolicy m_schedulingPolicy;
+    int m_schedulingPriority;
+    bool m_lockMemory;
+
+    // running sums for the current statistics period
+    AirCursorStatistics m_statistics;
+    qreal m_wakeIntervalSum;
+    qreal m_schedulingDelaySum;
+    qreal m_schedulingDelaySumSq;
+    qreal m_grabAnalysisSum;
+    qreal m_depthFilterSum;
+    qint64 m_activeCpuSum;
+    qint64 m_activeWallSum;
+    qint64 m_idleCpuSum;
+    qint64 m_idleWallSum;
+    qreal m_wakeLatencySum;
+    QElapsedTimer m_analysisTimer;
 
     xn::GestureGenerator m_gestureGenerator;
     xn::HandsGenerator m_handsGenerator;
 
     XnVSessionManager m_sessionManager;
+    bool m_sessionActive;
+
+    AcquisitionMode m_acquisitionMode;
+    int m_engagementNear;
+    int m_engagementFar;
+    XnPoint3D m_blobCandidate;
+    int m_blobFrames;
+
+    IdlePolicy m_idlePolicy;
+    int m_idleFrameInterval;
+    quint32 m_idleFrames;
+
+    // nite time of the current frame and the start of the engagement that may start a session
+    qreal m_frameTime;
+    qreal m_engageTime;
+
+    // time of the first frame skipped since the last processed one, -1.0 if none was skipped
+    qreal m_skipStartTime;
+
+    // last known movement of the hand and recovery of a lost hand
+    qreal m_recoveryWindow;
+    qreal m_lastHandTime;
+    XnPoint3D m_handVelocity;
+
+    // listeners including the signals, and the current hand's id and time for their events
+    SignalListener m_signalListener;
+    AirCursorListenerList m_listeners;
+    quint32 m_handId;
+    qreal m_handTime;
+    bool m_recovering;
+    qreal m_lostTime;
+    quint32 m_lostHandId;
+    int m_recoveryFrames;
+    XnUserID m_recoveredNiteId;
+    quint32 m_recoveredHandId;
 
     xn::DepthGenerator m_depthGenerator;
+    DepthProjection m_projection;
     XnVPushDetector m_pushDetector;
     XnVSwipeDetector m_swipeDetector;
 
+    GestureEngine m_gestureEngine;
+    GestureDetector m_gestureDetector;
+
     bool m_init;
 
+    // init requested to run on the tracker thread, and the phase being timed
+    bool m_asyncInit;
+    QElapsedTimer m_initTimer;
+    QElapsedTimer m_initPhaseTimer;
+    QString m_initPhase;
+    int m_initStep;
+
     XnDepthPixel* m_depthMap;
 
     bool m_grabbing;
@@ -140,21 +586,42 @@ private:
     IplImage* m_iplDepthMap;
     IplImage* m_iplDebugImage;
 
-    bool m_quit;
+    DepthFilters m_depthFilters;
+    IplImage* m_iplFilterTemp;
+
+    // analysis pipeline instantiation selected in init
+    bool m_genericPipeline;
+    void (AirCursor::*m_analyzeGrab)(const XnDepthPixel* depthMap);
+
+    // lifecycle requests from other threads. the flags are read lock free on every frame,
+    // the condition wakes the tracker from a pause or from waiting for a frame
+    QAtomicInt m_quit;
+    mutable QAtomicInt m_paused;
+    QMutex m_stateMutex;
+    QWaitCondition m_stateChanged;
+    XnCallbackHandle m_newDataCallback;
 
     XnPoint3D m_handPosRealWorld;
     XnPoint3D m_handPosProjected;
     XnPoint3D m_handPosSmooth;
 
     QImage* m_debugImage;
+    QImage m_debugDepthImage;
+    QImage m_debugHandMask;
 
     bool m_debugImageEnabled;
+    bool m_debugGeometryEnabled;
+    bool m_debugDepthEnabled;
 
     XnPoint3D m_grabStarted;
 
+    GrabParameters m_grabParameters;
     bool m_grabDetected;
     bool m_currentGrab;
     qreal m_runningGrab;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(AirCursor::DebugModes)
+Q_DECLARE_OPERATORS_FOR_FLAGS(AirCursor::DepthFilters)
+
 #endif // AIRCURSOR_H
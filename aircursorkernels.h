@@ -0,0 +1,212 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Per-pixel loops of the grab analysis. Loops are templates on frame
+    geometry: FixedGeometry makes width, height and stride compile time
+    constants, DynamicGeometry takes them from the actual depth mode.
+*/
+
+#ifndef AIRCURSORKERNELS_H
+#define AIRCURSORKERNELS_H
+
+#include <QtGlobal>
+#include <QList>
+#include <XnTypes.h>
+#include <cv.h>
+
+// allowed depth range in millimeters.
+const int NEAR_CLIPPING_DISTANCE = 500;
+const int FAR_CLIPPING_DISTANCE = 2000;
+
+// how far from the depth Nite gives the hand depth is searched in the histogram, in 8bit depth units
+const int HAND_DEPTH_SEARCH_RANGE = 8;
+
+// how much further away (z distance) points are included to be part of user's hand
+// TODO change this to be in mm.
+const int DEPTH_THRESHOLD = 10;
+
+// geometry of an 8bit frame known at compile time. stride equals width,
+// which holds for IplImages whose width is a multiple of 4
+template <int Width, int Height>
+struct FixedGeometry
+{
+    FixedGeometry(int, int, int) {}
+    static bool matches(int width, int height, int stride) { return width == Width && height == Height && stride == Width; }
+
+    int width() const { return Width; }
+    int height() const { return Height; }
+    int stride() const { return Width; }
+};
+
+// geometry of an 8bit frame known at run time
+struct DynamicGeometry
+{
+    DynamicGeometry(int width, int height, int stride) : m_width(width), m_height(height), m_stride(stride) {}
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int stride() const { return m_stride; }
+
+private:
+    int m_width;
+    int m_height;
+    int m_stride;
+};
+
+// maps depth in the allowed range determined by clipping distances to 1 - 255 so that 255 is
+// the closest value, and depth outside it to 0
+static inline unsigned char depthToPixel(int depth)
+{
+    if (depth < NEAR_CLIPPING_DISTANCE || depth > FAR_CLIPPING_DISTANCE) return 0;
+    depth -= NEAR_CLIPPING_DISTANCE;
+    return 255 - (255.0f * ((float)depth / (FAR_CLIPPING_DISTANCE - NEAR_CLIPPING_DISTANCE)));
+}
+
+static inline void convertDepthRow(const XnDepthPixel* src, unsigned char* dst, int count)
+{
+    for (int x = 0; x < count; x++) dst[x] = depthToPixel(src[x]);
+}
+
+// same as above but also counts the converted values to histogram
+static inline void convertDepthRow(const XnDepthPixel* src, unsigned char* dst, int count, int* histogram)
+{
+    for (int x = 0; x < count; x++)
+    {
+        unsigned char pixel = depthToPixel(src[x]);
+        dst[x] = pixel;
+        histogram[pixel]++;
+    }
+}
+
+// converts 16bit depth map to 8bit depth. rows of the region of interest also collect
+// a histogram of the hand depth on the same pass. histogram needs 256 zeroed bins
+template <class Geometry>
+static void convertDepth(const Geometry& g, const XnDepthPixel* depthMap, unsigned char* dst, const CvRect& roi, int* histogram)
+{
+    const int left = roi.x, right = roi.x + roi.width;
+    for (int y = 0; y < g.height(); y++)
+    {
+        const XnDepthPixel* srcLine = depthMap + y * g.width();
+        unsigned char* dstLine = dst + y * g.stride();
+
+        if (y >= roi.y && y < roi.y + roi.height)
+        {
+            convertDepthRow(srcLine, dstLine, left);
+            convertDepthRow(srcLine + left, dstLine + left, right - left, histogram);
+            convertDepthRow(srcLine + right, dstLine + right, g.width() - right);
+        }
+        else
+        {
+            convertDepthRow(srcLine, dstLine, g.width());
+        }
+    }
+}
+
+// returns the center of the most populated three bins near expected 8bit depth.
+// missing depth (0) is never counted. falls back to expected when there's no depth near it
+static inline int handDepthPixel(const int* histogram, int expected)
+{
+    int first = qMax(2, expected - HAND_DEPTH_SEARCH_RANGE);
+    int last = qMin(254, expected + HAND_DEPTH_SEARCH_RANGE);
+
+    int best = expected;
+    int bestCount = 0;
+    for (int i = first; i <= last; i++)
+    {
+        int count = histogram[i - 1] + histogram[i] + histogram[i + 1];
+        if (count > bestCount)
+        {
+            best = i;
+            bestCount = count;
+        }
+    }
+    return best;
+}
+
+// paints non-zero mask pixels of the region of interest to an rgb888 image with given color
+template <class Geometry>
+static void paintHand(const Geometry& g, const unsigned char* mask, unsigned char* rgb, int rgbStride, const CvRect& roi,
+                      unsigned char r, unsigned char gr, unsigned char b)
+{
+    for (int y = roi.y; y < roi.y + roi.height; y++)
+    {
+        const unsigned char* maskLine = mask + y * g.stride();
+        unsigned char* rgbLine = rgb + y * rgbStride;
+        for (int x = roi.x; x < roi.x + roi.width; x++)
+        {
+            if (maskLine[x] > 0)
+            {
+                rgbLine[x * 3 + 0] = r;
+                rgbLine[x * 3 + 1] = gr;
+                rgbLine[x * 3 + 2] = b;
+            }
+        }
+    }
+}
+
+// sets non-zero mask pixels of the region of interest in a 1bit msb first bitmap
+template <class Geometry>
+static void packHandMask(const Geometry& g, const unsigned char* mask, uchar* bits, int bytesPerLine, const CvRect& roi)
+{
+    for (int y = roi.y; y < roi.y + roi.height; y++)
+    {
+        const unsigned char* maskLine = mask + y * g.stride();
+        uchar* bitsLine = bits + y * bytesPerLine;
+        for (int x = roi.x; x < roi.x + roi.width; x++)
+        {
+            if (maskLine[x] > 0) bitsLine[x >> 3] |= 0x80 >> (x & 7);
+        }
+    }
+}
+
+// adds a raw hand position to the newest count positions and returns their mean
+static inline XnPoint3D smoothHandPoint(QList<XnPoint3D>& points, const XnPoint3D& point, int count)
+{
+    while (points.size() > count - 1) points.pop_front();
+    points.push_back(point);
+
+    XnPoint3D cumul;
+    cumul.X = cumul.Y = cumul.Z = 0;
+    for (int i = 0; i < points.size(); i++)
+    {
+        cumul.X += points[i].X;
+        cumul.Y += points[i].Y;
+        cumul.Z += points[i].Z;
+    }
+
+    XnPoint3D mean;
+    mean.X = cumul.X / points.size();
+    mean.Y = cumul.Y / points.size();
+    mean.Z = cumul.Z / points.size();
+    return mean;
+}
+
+// feeds the frame's grab detection to the running grab value and changes grab state when it
+// passes the threshold. returns 1 for grab, -1 for release and 0 when state didn't change
+static inline int updateGrabState(qreal& runningGrab, bool& grabbing, bool currentGrab, qreal smoothing, qreal threshold)
+{
+    runningGrab = smoothing * runningGrab + (1.0 - smoothing) * (float)currentGrab;
+
+    if (!grabbing)
+    {
+        if (runningGrab > (0.5 + threshold))
+        {
+            grabbing = true;
+            return 1;
+        }
+    }
+    else
+    {
+        if (runningGrab < (0.5 - threshold))
+        {
+            grabbing = false;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#endif // AIRCURSORKERNELS_H
@@ -0,0 +1,223 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Direct listener interface for air cursor events.
+
+    Listeners are called synchronously on the tracker thread, without the
+    meta-object system and without allocating anything per event. They are
+    meant for consumers that don't live in the GUI thread, such as loggers
+    and network bridges, and must return quickly because tracking waits for
+    them. Air cursor's Qt signals are emitted by one such listener.
+*/
+
+#include <QThread>
+
+#include "aircursorlistener.h"
+
+AirCursorListenerList::AirCursorListenerList() :
+    m_count(0),
+    m_sequence(0)
+{
+}
+
+bool AirCursorListenerList::add(AirCursorListener* listener)
+{
+    if (!listener) return false;
+    for (int i = 0; i < MAX_LISTENERS; i++)
+    {
+        if (m_listeners[i] == listener) return false;
+    }
+
+    for (int i = 0; i < MAX_LISTENERS; i++)
+    {
+        if (!m_listeners[i].testAndSetOrdered(0, listener)) continue;
+
+        // another add of the same listener may have taken a slot after the scan above
+        for (int j = 0; j < MAX_LISTENERS; j++)
+        {
+            if (j != i && m_listeners[j] == listener)
+            {
+                m_listeners[i].testAndSetOrdered(listener, 0);
+                return false;
+            }
+        }
+
+        // raise the number of slots events look at, another add may be raising it too
+        int count = m_count.fetchAndAddOrdered(0);
+        while (count < i + 1 && !m_count.testAndSetOrdered(count, i + 1)) count = m_count.fetchAndAddOrdered(0);
+        return true;
+    }
+    return false;
+}
+
+void AirCursorListenerList::remove(AirCursorListener* listener)
+{
+    if (!listener) return;
+    for (int i = 0; i < MAX_LISTENERS; i++)
+    {
+        if (m_listeners[i].testAndSetOrdered(listener, 0)) break;
+    }
+
+    // an event that started before the slot was cleared may still be calling the listener
+    int sequence = m_sequence.fetchAndAddOrdered(0);
+    if (sequence & 1)
+    {
+        while (m_sequence.fetchAndAddOrdered(0) == sequence) QThread::yieldCurrentThread();
+    }
+}
+
+void AirCursorListenerList::beginEvent()
+{
+    m_sequence.fetchAndAddOrdered(1);
+}
+
+void AirCursorListenerList::endEvent()
+{
+    m_sequence.fetchAndAddOrdered(1);
+}
+
+// events read the slots with plain loads, the listener was published by the ordered store in add()
+
+void AirCursorListenerList::deliver(void (AirCursorListener::*event)())
+{
+    beginEvent();
+    int count = m_count;
+    for (int i = 0; i < count; i++)
+    {
+        AirCursorListener* listener = m_listeners[i];
+        if (listener) (listener->*event)();
+    }
+    endEvent();
+}
+
+template <class P1, class A1>
+void AirCursorListenerList::deliver(void (AirCursorListener::*event)(P1), const A1& a1)
+{
+    beginEvent();
+    int count = m_count;
+    for (int i = 0; i < count; i++)
+    {
+        AirCursorListener* listener = m_listeners[i];
+        if (listener) (listener->*event)(a1);
+    }
+    endEvent();
+}
+
+template <class P1, class P2, class A1, class A2>
+void AirCursorListenerList::deliver(void (AirCursorListener::*event)(P1, P2), const A1& a1, const A2& a2)
+{
+    beginEvent();
+    int count = m_count;
+    for (int i = 0; i < count; i++)
+    {
+        AirCursorListener* listener = m_listeners[i];
+        if (listener) (listener->*event)(a1, a2);
+    }
+    endEvent();
+}
+
+template <class P1, class P2, class P3, class A1, class A2, class A3>
+void AirCursorListenerList::deliver(void (AirCursorListener::*event)(P1, P2, P3), const A1& a1, const A2& a2, const A3& a3)
+{
+    beginEvent();
+    int count = m_count;
+    for (int i = 0; i < count; i++)
+    {
+        AirCursorListener* listener = m_listeners[i];
+        if (listener) (listener->*event)(a1, a2, a3);
+    }
+    endEvent();
+}
+
+void AirCursorListenerList::handCreate(const AirCursorHandFrame& frame)
+{
+    deliver(&AirCursorListener::handCreate, frame);
+}
+
+void AirCursorListenerList::handUpdate(const AirCursorHandFrame& frame)
+{
+    deliver(&AirCursorListener::handUpdate, frame);
+}
+
+void AirCursorListenerList::handDestroy(qreal time)
+{
+    deliver(&AirCursorListener::handDestroy, time);
+}
+
+void AirCursorListenerList::handLost(qreal time)
+{
+    deliver(&AirCursorListener::handLost, time);
+}
+
+void AirCursorListenerList::handRecovered(const AirCursorHandFrame& frame)
+{
+    deliver(&AirCursorListener::handRecovered, frame);
+}
+
+void AirCursorListenerList::handTooClose()
+{
+    deliver(&AirCursorListener::handTooClose);
+}
+
+void AirCursorListenerList::handTooFar()
+{
+    deliver(&AirCursorListener::handTooFar);
+}
+
+void AirCursorListenerList::grab(const AirCursorHandFrame& frame)
+{
+    deliver(&AirCursorListener::grab, frame);
+}
+
+void AirCursorListenerList::grabRelease(const AirCursorHandFrame& frame)
+{
+    deliver(&AirCursorListener::grabRelease, frame);
+}
+
+void AirCursorListenerList::push(const AirCursorHandFrame& frame, qreal velocity, qreal angle)
+{
+    deliver(&AirCursorListener::push, frame, velocity, angle);
+}
+
+void AirCursorListenerList::swipeUp(qreal velocity, qreal angle)
+{
+    deliver(&AirCursorListener::swipeUp, velocity, angle);
+}
+
+void AirCursorListenerList::swipeDown(qreal velocity, qreal angle)
+{
+    deliver(&AirCursorListener::swipeDown, velocity, angle);
+}
+
+void AirCursorListenerList::swipeLeft(qreal velocity, qreal angle)
+{
+    deliver(&AirCursorListener::swipeLeft, velocity, angle);
+}
+
+void AirCursorListenerList::swipeRight(qreal velocity, qreal angle)
+{
+    deliver(&AirCursorListener::swipeRight, velocity, angle);
+}
+
+void AirCursorListenerList::gestureRecognized(const QString& gesture)
+{
+    deliver(&AirCursorListener::gestureRecognized, gesture);
+}
+
+void AirCursorListenerList::gestureProcess(const QString& gesture)
+{
+    deliver(&AirCursorListener::gestureProcess, gesture);
+}
+
+void AirCursorListenerList::sessionStart()
+{
+    deliver(&AirCursorListener::sessionStart);
+}
+
+void AirCursorListenerList::sessionEnd()
+{
+    deliver(&AirCursorListener::sessionEnd);
+}
@@ -0,0 +1,133 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Direct listener interface for air cursor events.
+
+    Listeners are called synchronously on the tracker thread, without the
+    meta-object system and without allocating anything per event. They are
+    meant for consumers that don't live in the GUI thread, such as loggers
+    and network bridges, and must return quickly because tracking waits for
+    them. Air cursor's Qt signals are emitted by one such listener.
+*/
+
+#ifndef AIRCURSORLISTENER_H
+#define AIRCURSORLISTENER_H
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QString>
+
+// hand data of one event. positions are real world mm in the transformed coordinates
+struct AirCursorHandFrame
+{
+    AirCursorHandFrame() : handId(0), x(0.0), y(0.0), z(0.0), time(0.0), grabbing(false) {}
+
+    // same id as AirCursor::trajectory(handId), kept over hand recovery
+    quint32 handId;
+
+    qreal x;
+    qreal y;
+    qreal z;
+
+    // sensor time in seconds
+    qreal time;
+
+    bool grabbing;
+};
+
+// events are the same as air cursor's signals, see aircursor.h. default implementations
+// do nothing so listeners implement only what they need
+class AirCursorListener
+{
+public:
+    virtual ~AirCursorListener() {}
+
+    // update has the hand's smoothed position. create and recovered have the position
+    // NITE reported, because there are no earlier points to smooth it with
+    virtual void handCreate(const AirCursorHandFrame& frame) { Q_UNUSED(frame); }
+    virtual void handUpdate(const AirCursorHandFrame& frame) { Q_UNUSED(frame); }
+    virtual void handDestroy(qreal time) { Q_UNUSED(time); }
+    virtual void handLost(qreal time) { Q_UNUSED(time); }
+    virtual void handRecovered(const AirCursorHandFrame& frame) { Q_UNUSED(frame); }
+    virtual void handTooClose() {}
+    virtual void handTooFar() {}
+
+    // grab and push have the hand's unsmoothed position
+    virtual void grab(const AirCursorHandFrame& frame) { Q_UNUSED(frame); }
+    virtual void grabRelease(const AirCursorHandFrame& frame) { Q_UNUSED(frame); }
+    virtual void push(const AirCursorHandFrame& frame, qreal velocity, qreal angle) { Q_UNUSED(frame); Q_UNUSED(velocity); Q_UNUSED(angle); }
+
+    virtual void swipeUp(qreal velocity, qreal angle) { Q_UNUSED(velocity); Q_UNUSED(angle); }
+    virtual void swipeDown(qreal velocity, qreal angle) { Q_UNUSED(velocity); Q_UNUSED(angle); }
+    virtual void swipeLeft(qreal velocity, qreal angle) { Q_UNUSED(velocity); Q_UNUSED(angle); }
+    virtual void swipeRight(qreal velocity, qreal angle) { Q_UNUSED(velocity); Q_UNUSED(angle); }
+
+    virtual void gestureRecognized(const QString& gesture) { Q_UNUSED(gesture); }
+    virtual void gestureProcess(const QString& gesture) { Q_UNUSED(gesture); }
+    virtual void sessionStart() {}
+    virtual void sessionEnd() {}
+};
+
+// fixed size set of listeners. adding and removing are lock free and can be done from
+// any thread while events are delivered on the tracker thread
+class AirCursorListenerList
+{
+public:
+    static const int MAX_LISTENERS = 8;
+
+    AirCursorListenerList();
+
+    // false if the list is full or the listener is already in it. two adds of the same
+    // listener racing each other may both return false
+    bool add(AirCursorListener* listener);
+
+    // when this returns the listener is not called anymore and can be deleted.
+    // waits for an event being delivered, so don't call it from a listener
+    void remove(AirCursorListener* listener);
+
+    // deliver the event to each listener in slot order
+    void handCreate(const AirCursorHandFrame& frame);
+    void handUpdate(const AirCursorHandFrame& frame);
+    void handDestroy(qreal time);
+    void handLost(qreal time);
+    void handRecovered(const AirCursorHandFrame& frame);
+    void handTooClose();
+    void handTooFar();
+    void grab(const AirCursorHandFrame& frame);
+    void grabRelease(const AirCursorHandFrame& frame);
+    void push(const AirCursorHandFrame& frame, qreal velocity, qreal angle);
+    void swipeUp(qreal velocity, qreal angle);
+    void swipeDown(qreal velocity, qreal angle);
+    void swipeLeft(qreal velocity, qreal angle);
+    void swipeRight(qreal velocity, qreal angle);
+    void gestureRecognized(const QString& gesture);
+    void gestureProcess(const QString& gesture);
+    void sessionStart();
+    void sessionEnd();
+
+private:
+    void beginEvent();
+    void endEvent();
+
+    // call the event on each listener, one overload per argument count
+    void deliver(void (AirCursorListener::*event)());
+    template <class P1, class A1>
+    void deliver(void (AirCursorListener::*event)(P1), const A1& a1);
+    template <class P1, class P2, class A1, class A2>
+    void deliver(void (AirCursorListener::*event)(P1, P2), const A1& a1, const A2& a2);
+    template <class P1, class P2, class P3, class A1, class A2, class A3>
+    void deliver(void (AirCursorListener::*event)(P1, P2, P3), const A1& a1, const A2& a2, const A3& a3);
+
+    QAtomicPointer<AirCursorListener> m_listeners[MAX_LISTENERS];
+
+    // slots in use are below this, so events don't scan empty slots
+    QAtomicInt m_count;
+
+    // odd while an event is being delivered, remove() waits for it to change
+    QAtomicInt m_sequence;
+};
+
+#endif // AIRCURSORLISTENER_H
@@ -0,0 +1,253 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    File layout, little endian:
+        "ACDC", version (16 bit), width (16 bit), height (16 bit)
+        per frame: timestamp in us (64 bit), hand flag (8 bit), hand x, y, z
+        (float mm), encoded size (32 bit) and the DepthCodec encoded frame
+*/
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <cstring>
+#include <iostream>
+
+#include "depthcapture.h"
+#include "depthcodec.h"
+
+const char CAPTURE_MAGIC[] = "ACDC";
+const quint16 CAPTURE_VERSION = 1;
+
+DepthCapture::DepthCapture() :
+    m_width(0),
+    m_height(0),
+    m_frames(0),
+    m_rawBytes(0),
+    m_encodedBytes(0)
+{
+}
+
+bool DepthCapture::create(const QString& fileName, int width, int height)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly))
+    {
+        std::cout << "creating capture " << fileName.toLocal8Bit().constData() << " failed" << std::endl;
+        return false;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_buffer.resize(DepthCodec::maxEncodedSize(width, height));
+
+    QDataStream stream(&m_file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.writeRawData(CAPTURE_MAGIC, 4);
+    stream << CAPTURE_VERSION << (quint16)width << (quint16)height;
+    return stream.status() == QDataStream::Ok;
+}
+
+bool DepthCapture::open(const QString& fileName)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        std::cout << "opening capture " << fileName.toLocal8Bit().constData() << " failed" << std::endl;
+        return false;
+    }
+
+    QDataStream stream(&m_file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    char magic[4];
+    quint16 version, width, height;
+    if (stream.readRawData(magic, 4) != 4 || memcmp(magic, CAPTURE_MAGIC, 4) != 0)
+    {
+        std::cout << fileName.toLocal8Bit().constData() << " is not a depth capture" << std::endl;
+        close();
+        return false;
+    }
+    stream >> version >> width >> height;
+    if (stream.status() != QDataStream::Ok || version != CAPTURE_VERSION)
+    {
+        std::cout << "unsupported depth capture version in " << fileName.toLocal8Bit().constData() << std::endl;
+        close();
+        return false;
+    }
+
+    m_width = width;
+    m_height = height;
+    return true;
+}
+
+void DepthCapture::close()
+{
+    if (m_file.isOpen()) m_file.close();
+    m_frames = 0;
+    m_rawBytes = m_encodedBytes = 0;
+}
+
+bool DepthCapture::writeFrame(const XnDepthPixel* frame, XnUInt64 timestamp, const XnPoint3D* hand)
+{
+    if (!m_file.isOpen()) return false;
+
+    int size = DepthCodec::encode(frame, m_width, m_height, (uchar*)m_buffer.data());
+
+    QDataStream stream(&m_file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    stream << (quint64)timestamp << (quint8)(hand != 0);
+    if (hand) stream << hand->X << hand->Y << hand->Z;
+    else stream << 0.0f << 0.0f << 0.0f;
+    stream << (quint32)size;
+    stream.writeRawData(m_buffer.constData(), size);
+
+    m_frames++;
+    m_rawBytes += m_width * m_height * sizeof(XnDepthPixel);
+    m_encodedBytes += size;
+    return stream.status() == QDataStream::Ok;
+}
+
+bool DepthCapture::readFrame(XnDepthPixel* frame, XnUInt64& timestamp, XnPoint3D& hand, bool& hasHand)
+{
+    if (!m_file.isOpen() || m_file.atEnd()) return false;
+
+    QDataStream stream(&m_file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    quint64 time;
+    quint8 handFlag;
+    quint32 size;
+    stream >> time >> handFlag >> hand.X >> hand.Y >> hand.Z >> size;
+    if (stream.status() != QDataStream::Ok || size > (quint32)DepthCodec::maxEncodedSize(m_width, m_height)) return false;
+
+    m_buffer.resize(size);
+    if (stream.readRawData(m_buffer.data(), size) != (int)size) return false;
+    if (!DepthCodec::decode((const uchar*)m_buffer.constData(), size, frame, m_width, m_height))
+    {
+        std::cout << "corrupt frame in capture " << m_file.fileName().toLocal8Bit().constData() << std::endl;
+        return false;
+    }
+
+    timestamp = time;
+    hasHand = handFlag != 0;
+    m_frames++;
+    m_rawBytes += m_width * m_height * sizeof(XnDepthPixel);
+    m_encodedBytes += size;
+    return true;
+}
+
+DepthCaptureWriter::DepthCaptureWriter() :
+    m_head(0),
+    m_queued(0),
+    m_quit(true),
+    m_failed(false)
+{
+}
+
+DepthCaptureWriter::~DepthCaptureWriter()
+{
+    close();
+}
+
+bool DepthCaptureWriter::create(const QString& fileName, int width, int height)
+{
+    close();
+    if (!m_capture.create(fileName, width, height)) return false;
+
+    for (int i = 0; i < QUEUE_SIZE; i++) m_queue[i].depth.resize(width * height);
+    m_head = m_queued = 0;
+    m_quit = m_failed = false;
+    m_statistics = DepthCaptureStatistics();
+
+    // below the tracker thread, which may be running with a real-time policy
+    start(QThread::LowPriority);
+    return true;
+}
+
+void DepthCaptureWriter::close()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        m_queueChanged.wakeAll();
+    }
+    wait();
+    m_capture.close();
+}
+
+bool DepthCaptureWriter::queueFrame(const XnDepthPixel* frame, XnUInt64 timestamp, const XnPoint3D* hand)
+{
+    int tail;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_failed || m_quit) return false;
+        if (m_queued == QUEUE_SIZE)
+        {
+            m_statistics.droppedFrames++;
+            return false;
+        }
+        tail = (m_head + m_queued) % QUEUE_SIZE;
+    }
+
+    // the writer doesn't touch the frame before it is queued, so it is copied unlocked
+    Frame& queued = m_queue[tail];
+    memcpy(queued.depth.data(), frame, queued.depth.size() * sizeof(XnDepthPixel));
+    queued.timestamp = timestamp;
+    queued.hasHand = hand != 0;
+    if (hand) queued.hand = *hand;
+
+    QMutexLocker locker(&m_mutex);
+    m_queued++;
+    m_queueChanged.wakeAll();
+    return true;
+}
+
+DepthCaptureStatistics DepthCaptureWriter::takeStatistics()
+{
+    QMutexLocker locker(&m_mutex);
+    DepthCaptureStatistics statistics = m_statistics;
+    m_statistics = DepthCaptureStatistics();
+    return statistics;
+}
+
+void DepthCaptureWriter::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QMutexLocker locker(&m_mutex);
+    while (true)
+    {
+        while (m_queued == 0 && !m_quit) m_queueChanged.wait(&m_mutex);
+
+        // the queue is written out before quitting
+        if (m_queued == 0) break;
+
+        Frame& frame = m_queue[m_head];
+        locker.unlock();
+
+        qint64 start = timer.nsecsElapsed();
+        qint64 rawBytes = m_capture.rawBytes(), encodedBytes = m_capture.encodedBytes();
+        bool ok = m_capture.writeFrame(frame.depth.constData(), frame.timestamp, frame.hasHand ? &frame.hand : 0);
+        qreal time = (timer.nsecsElapsed() - start) / 1000000.0;
+
+        locker.relock();
+        m_head = (m_head + 1) % QUEUE_SIZE;
+        m_queued--;
+        if (!ok)
+        {
+            std::cout << "writing depth capture failed, capture stopped" << std::endl;
+            m_failed = true;
+            break;
+        }
+        m_statistics.frames++;
+        m_statistics.time += time;
+        m_statistics.rawBytes += m_capture.rawBytes() - rawBytes;
+        m_statistics.encodedBytes += m_capture.encodedBytes() - encodedBytes;
+    }
+}
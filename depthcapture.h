@@ -0,0 +1,133 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    File of losslessly compressed depth frames with their sensor timestamps
+    and the hand point tracked on each frame, for capturing sessions on the
+    field and replaying them through AirCursor::processFrame().
+
+    DepthCaptureWriter compresses and writes frames on its own thread, so
+    capturing doesn't add disk latency to the thread that produces them.
+*/
+
+#ifndef DEPTHCAPTURE_H
+#define DEPTHCAPTURE_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <XnTypes.h>
+
+class DepthCapture
+{
+public:
+
+    DepthCapture();
+
+    // new file for writing frames of given size, or an existing file for reading
+    bool create(const QString& fileName, int width, int height);
+    bool open(const QString& fileName);
+    void close();
+
+    bool isOpen() const { return m_file.isOpen(); }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    // hand is 0 if no hand was tracked on the frame
+    bool writeFrame(const XnDepthPixel* frame, XnUInt64 timestamp, const XnPoint3D* hand);
+
+    // false at the end of the file or on a corrupt frame
+    bool readFrame(XnDepthPixel* frame, XnUInt64& timestamp, XnPoint3D& hand, bool& hasHand);
+    bool atEnd() const { return !m_file.isOpen() || m_file.atEnd(); }
+
+    // frames and their raw and encoded sizes in bytes since create or open
+    quint32 frames() const { return m_frames; }
+    qint64 rawBytes() const { return m_rawBytes; }
+    qint64 encodedBytes() const { return m_encodedBytes; }
+
+private:
+    QFile m_file;
+    int m_width;
+    int m_height;
+
+    // encoded frame, kept to avoid allocating per frame
+    QByteArray m_buffer;
+
+    quint32 m_frames;
+    qint64 m_rawBytes;
+    qint64 m_encodedBytes;
+};
+
+// capture writer counters since the previous takeStatistics(), time is in milliseconds
+struct DepthCaptureStatistics
+{
+    DepthCaptureStatistics() : frames(0), droppedFrames(0), time(0.0), rawBytes(0), encodedBytes(0) {}
+
+    // frames written, and frames dropped because the queue was full
+    quint32 frames;
+    quint32 droppedFrames;
+
+    // total time spent compressing and writing
+    qreal time;
+
+    qint64 rawBytes;
+    qint64 encodedBytes;
+};
+
+// writes frames to a depth capture from a bounded queue on its own thread. queuing a
+// frame only copies it, and frames are dropped instead of waiting when the disk is slow
+class DepthCaptureWriter : public QThread
+{
+public:
+    static const int QUEUE_SIZE = 8;
+
+    DepthCaptureWriter();
+    ~DepthCaptureWriter();
+
+    // creates the file and starts the writer thread
+    bool create(const QString& fileName, int width, int height);
+
+    // writes the queued frames and closes the file
+    void close();
+
+    // false if the frame was dropped or writing has failed. hand is 0 if no hand was tracked
+    bool queueFrame(const XnDepthPixel* frame, XnUInt64 timestamp, const XnPoint3D* hand);
+
+    // counters since the previous call
+    DepthCaptureStatistics takeStatistics();
+
+protected:
+    void run();
+
+private:
+    struct Frame
+    {
+        QVector<XnDepthPixel> depth;
+        XnUInt64 timestamp;
+        XnPoint3D hand;
+        bool hasHand;
+    };
+
+    DepthCapture m_capture;
+
+    // frames from m_head to m_head + m_queued are waiting to be written. only the
+    // writer changes m_head and only the producer writes the frame after the queued ones
+    Frame m_queue[QUEUE_SIZE];
+    int m_head;
+    int m_queued;
+
+    // set while no file is being written
+    bool m_quit;
+    bool m_failed;
+    DepthCaptureStatistics m_statistics;
+
+    QMutex m_mutex;
+    QWaitCondition m_queueChanged;
+};
+
+#endif // DEPTHCAPTURE_H
@@ -0,0 +1,310 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Lossless compression of 16 bit depth frames.
+
+    Each pixel is predicted from its left neighbour, or from the pixel above
+    after a gap, and the prediction error is Rice coded with a parameter
+    adapted from the previous row. Zero depth, which is what the sensor gives
+    for missing and out of range pixels, is run length coded. One pass over
+    the frame in both directions, no tables or allocations.
+*/
+
+#include "depthcodec.h"
+
+// width and height in front of the bit stream
+const int HEADER_SIZE = 4;
+
+// rice parameter of the first row and the largest one used
+const int INITIAL_RICE = 4;
+const int MAX_RICE = 15;
+
+// quotients this large are sent as escape and the whole symbol in raw bits,
+// so that other codes fit in 32 bits with the largest rice parameter
+const int RICE_ESCAPE = 16;
+const int SYMBOL_BITS = 17;
+
+// zero prediction error is symbol 0 and a run of zero depth pixels symbol 1,
+// other errors are their zigzag value plus one
+const quint32 RUN_SYMBOL = 1;
+
+// msb first bit writer, flushes 32 bits at a time
+class BitWriter
+{
+public:
+    BitWriter(uchar* output) : m_output(output), m_acc(0), m_bits(0), m_size(0) {}
+
+    // n at most 32
+    inline void write(quint32 value, int n)
+    {
+        m_acc = (m_acc << n) | value;
+        m_bits += n;
+        if (m_bits >= 32)
+        {
+            m_bits -= 32;
+            quint32 word = (quint32)(m_acc >> m_bits);
+            m_output[m_size] = word >> 24;
+            m_output[m_size + 1] = word >> 16;
+            m_output[m_size + 2] = word >> 8;
+            m_output[m_size + 3] = word;
+            m_size += 4;
+        }
+    }
+
+    // exp-golomb, for run lengths
+    inline void writeGolomb(quint32 value)
+    {
+        value++;
+        int n = 0;
+        while ((value >> n) > 1) n++;
+        write(0, n);
+        write(value, n + 1);
+    }
+
+    inline void writeRice(quint32 symbol, int k)
+    {
+        quint32 q = symbol >> k;
+        if (q < (quint32)RICE_ESCAPE)
+        {
+            // q ones, a zero and the k low bits in one write
+            write((((1u << (q + 1)) - 2) << k) | (symbol & ((1u << k) - 1)), q + 1 + k);
+        }
+        else
+        {
+            write((1u << RICE_ESCAPE) - 1, RICE_ESCAPE);
+            write(symbol, SYMBOL_BITS);
+        }
+    }
+
+    // pads the last byte with zeros and returns the bytes written
+    int finish()
+    {
+        if (m_bits == 0) return m_size;
+        quint64 rest = m_acc << (64 - m_bits);
+        for (int i = 0; i < m_bits; i += 8)
+        {
+            m_output[m_size++] = rest >> 56;
+            rest <<= 8;
+        }
+        m_bits = 0;
+        return m_size;
+    }
+
+private:
+    uchar* m_output;
+    quint64 m_acc;
+    int m_bits;
+    int m_size;
+};
+
+// msb first bit reader that reads zeros past the end and tells afterwards if it did
+class BitReader
+{
+public:
+    BitReader(const uchar* data, int size) : m_data(data), m_end(data + size), m_acc(0), m_bits(0), m_overrun(0) { refill(); }
+
+    inline void refill()
+    {
+        while (m_bits <= 56)
+        {
+            if (m_data < m_end) m_acc |= (quint64)*m_data++ << (56 - m_bits);
+            else m_overrun += 8;
+            m_bits += 8;
+        }
+    }
+
+    // n at most 32
+    inline quint32 read(int n)
+    {
+        if (n == 0) return 0;
+        if (m_bits < n) refill();
+        quint32 value = (quint32)(m_acc >> (64 - n));
+        m_acc <<= n;
+        m_bits -= n;
+        return value;
+    }
+
+    inline quint32 readGolomb()
+    {
+        if (m_bits < 32) refill();
+        int n = leadingZeros(m_acc);
+        if (n > 31) n = 31;
+        read(n);
+        return read(n + 1) - 1;
+    }
+
+    inline quint32 readRice(int k)
+    {
+        if (m_bits < 32) refill();
+        int q = leadingZeros(~m_acc);
+        if (q >= RICE_ESCAPE)
+        {
+            read(RICE_ESCAPE);
+            return read(SYMBOL_BITS);
+        }
+        const quint32 low = read(q + 1 + k) & ((1u << k) - 1);
+        return ((quint32)q << k) | low;
+    }
+
+    // true if more bits were read than the data had
+    bool overrun() const { return m_overrun > m_bits; }
+
+private:
+    static inline int leadingZeros(quint64 value)
+    {
+#ifdef __GNUC__
+        return value ? __builtin_clzll(value) : 64;
+#else
+        int n = 0;
+        while (n < 64 && !(value & (Q_UINT64_C(1) << (63 - n)))) n++;
+        return n;
+#endif
+    }
+
+    const uchar* m_data;
+    const uchar* m_end;
+    quint64 m_acc;
+    int m_bits;
+    int m_overrun;
+};
+
+// rice parameter matching the mean symbol of a row
+static inline int riceParameter(quint32 sum, quint32 count)
+{
+    if (count == 0) return INITIAL_RICE;
+    int k = 0;
+    while (k < MAX_RICE && ((quint64)count << (k + 1)) <= sum) k++;
+    return k;
+}
+
+int DepthCodec::maxEncodedSize(int width, int height)
+{
+    // escape and raw symbol per pixel, rice parameters are not sent
+    return HEADER_SIZE + (width * height * (RICE_ESCAPE + SYMBOL_BITS) + 7) / 8 + 8;
+}
+
+int DepthCodec::encode(const XnDepthPixel* frame, int width, int height, uchar* output)
+{
+    output[0] = width >> 8;
+    output[1] = width;
+    output[2] = height >> 8;
+    output[3] = height;
+    BitWriter writer(output + HEADER_SIZE);
+
+    int k = INITIAL_RICE;
+    for (int y = 0; y < height; y++)
+    {
+        const XnDepthPixel* row = frame + y * width;
+        const XnDepthPixel* up = y > 0 ? row - width : 0;
+        quint32 sum = 0, count = 0;
+
+        // last nonzero pixel of the row, and whether the previous pixel was a gap
+        XnDepthPixel last = 0;
+        bool gap = true;
+
+        int x = 0;
+        while (x < width)
+        {
+            const XnDepthPixel value = row[x];
+            if (value == 0)
+            {
+                int run = 1;
+                while (x + run < width && row[x + run] == 0) run++;
+                writer.writeRice(RUN_SYMBOL, k);
+                writer.writeGolomb(run - 1);
+                x += run;
+                gap = true;
+                continue;
+            }
+
+            XnDepthPixel prediction = row[x - (x > 0)];
+            if (gap) prediction = up && up[x] ? up[x] : last;
+
+            // zigzag of the 16 bit wrapped difference, 1 is reserved for runs
+            const qint16 residual = (qint16)(value - prediction);
+            const quint32 zigzag = (quint16)(((quint16)residual << 1) ^ (quint16)(residual >> 15));
+            const quint32 symbol = zigzag ? zigzag + 1 : 0;
+            writer.writeRice(symbol, k);
+            sum += symbol;
+            count++;
+
+            last = value;
+            gap = false;
+            x++;
+        }
+
+        k = riceParameter(sum, count);
+    }
+
+    return HEADER_SIZE + writer.finish();
+}
+
+QByteArray DepthCodec::encode(const XnDepthPixel* frame, int width, int height)
+{
+    QByteArray data(maxEncodedSize(width, height), 0);
+    data.resize(encode(frame, width, height, (uchar*)data.data()));
+    return data;
+}
+
+bool DepthCodec::decode(const uchar* data, int size, XnDepthPixel* frame, int width, int height)
+{
+    if (size < HEADER_SIZE) return false;
+    if (((data[0] << 8) | data[1]) != width || ((data[2] << 8) | data[3]) != height) return false;
+    BitReader reader(data + HEADER_SIZE, size - HEADER_SIZE);
+
+    int k = INITIAL_RICE;
+    for (int y = 0; y < height; y++)
+    {
+        XnDepthPixel* row = frame + y * width;
+        const XnDepthPixel* up = y > 0 ? row - width : 0;
+        quint32 sum = 0, count = 0;
+
+        XnDepthPixel last = 0;
+        bool gap = true;
+
+        int x = 0;
+        while (x < width)
+        {
+            const quint32 symbol = reader.readRice(k);
+            if (symbol == RUN_SYMBOL)
+            {
+                const quint32 run = reader.readGolomb();
+                if (run >= (quint32)(width - x)) return false;
+                for (quint32 i = 0; i <= run; i++) row[x + i] = 0;
+                x += run + 1;
+                gap = true;
+                continue;
+            }
+
+            XnDepthPixel prediction = row[x - (x > 0)];
+            if (gap) prediction = up && up[x] ? up[x] : last;
+
+            const quint32 zigzag = symbol ? symbol - 1 : 0;
+            const qint16 residual = (qint16)((zigzag >> 1) ^ (0 - (zigzag & 1)));
+            const XnDepthPixel value = prediction + residual;
+
+            // a zero would have been a run
+            if (value == 0) return false;
+            row[x] = value;
+            sum += symbol;
+            count++;
+
+            last = value;
+            gap = false;
+            x++;
+        }
+
+        k = riceParameter(sum, count);
+        if (reader.overrun()) return false;
+    }
+
+    return true;
+}
+
+bool DepthCodec::decode(const QByteArray& data, XnDepthPixel* frame, int width, int height)
+{
+    return decode((const uchar*)data.constData(), data.size(), frame, width, height);
+}
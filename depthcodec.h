@@ -0,0 +1,38 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Lossless compression of 16 bit depth frames.
+
+    Each pixel is predicted from its left neighbour, or from the pixel above
+    after a gap, and the prediction error is Rice coded with a parameter
+    adapted from the previous row. Zero depth, which is what the sensor gives
+    for missing and out of range pixels, is run length coded. One pass over
+    the frame in both directions, no tables or allocations.
+*/
+
+#ifndef DEPTHCODEC_H
+#define DEPTHCODEC_H
+
+#include <QByteArray>
+#include <XnTypes.h>
+
+class DepthCodec
+{
+public:
+
+    // worst case size of an encoded frame in bytes
+    static int maxEncodedSize(int width, int height);
+
+    // encodes frame to output, which needs maxEncodedSize bytes, and returns the size used
+    static int encode(const XnDepthPixel* frame, int width, int height, uchar* output);
+    static QByteArray encode(const XnDepthPixel* frame, int width, int height);
+
+    // decodes to frame, false if data is corrupt or of a different size
+    static bool decode(const uchar* data, int size, XnDepthPixel* frame, int width, int height);
+    static bool decode(const QByteArray& data, XnDepthPixel* frame, int width, int height);
+};
+
+#endif // DEPTHCODEC_H
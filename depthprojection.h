@@ -0,0 +1,122 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Pinhole projection between real world (mm) and projective (depth map pixel)
+    coordinates, same model OpenNI uses in ConvertRealWorldToProjective.
+
+    Field of view is read once from the depth generator so that conversions
+    don't need to call into OpenNI. Array versions are plain loops the
+    compiler can vectorize.
+*/
+
+#ifndef DEPTHPROJECTION_H
+#define DEPTHPROJECTION_H
+
+#include <qmath.h>
+#include <XnTypes.h>
+
+class DepthProjection
+{
+public:
+
+    // defaults are the Kinect depth camera's field of view at 640x480
+    DepthProjection()
+    {
+        setFieldOfView(1.0144686707507438, 0.78980943449644714, 640, 480);
+    }
+
+    // field of view in radians and resolution of the depth map
+    void setFieldOfView(qreal horizontalFov, qreal verticalFov, int xRes, int yRes)
+    {
+        m_xRes = xRes;
+        m_yRes = yRes;
+        m_xToZ = qTan(horizontalFov / 2.0) * 2.0;
+        m_yToZ = qTan(verticalFov / 2.0) * 2.0;
+        m_coeffX = xRes / m_xToZ;
+        m_coeffY = yRes / m_yToZ;
+        m_halfXRes = xRes / 2;
+        m_halfYRes = yRes / 2;
+    }
+
+    // keeps the field of view, for scaled depth maps
+    void setResolution(int xRes, int yRes)
+    {
+        m_xRes = xRes;
+        m_yRes = yRes;
+        m_coeffX = xRes / m_xToZ;
+        m_coeffY = yRes / m_yToZ;
+        m_halfXRes = xRes / 2;
+        m_halfYRes = yRes / 2;
+    }
+
+    int xRes() const { return m_xRes; }
+    int yRes() const { return m_yRes; }
+
+    inline XnPoint3D toProjective(const XnPoint3D& realWorld) const
+    {
+        XnPoint3D projective;
+        float invZ = 1.0f / realWorld.Z;
+        projective.X = m_coeffX * realWorld.X * invZ + m_halfXRes;
+        projective.Y = m_halfYRes - m_coeffY * realWorld.Y * invZ;
+        projective.Z = realWorld.Z;
+        return projective;
+    }
+
+    inline XnPoint3D toRealWorld(const XnPoint3D& projective) const
+    {
+        XnPoint3D realWorld;
+        realWorld.X = (projective.X / m_xRes - 0.5f) * projective.Z * m_xToZ;
+        realWorld.Y = (0.5f - projective.Y / m_yRes) * projective.Z * m_yToZ;
+        realWorld.Z = projective.Z;
+        return realWorld;
+    }
+
+    void toProjective(const XnPoint3D* realWorld, XnPoint3D* projective, int count) const
+    {
+        for (int i = 0; i < count; i++) projective[i] = toProjective(realWorld[i]);
+    }
+
+    void toRealWorld(const XnPoint3D* projective, XnPoint3D* realWorld, int count) const
+    {
+        for (int i = 0; i < count; i++) realWorld[i] = toRealWorld(projective[i]);
+    }
+
+    // separate coordinate arrays, e.g. a whole contour with its depths. output can be the same as input
+    void toProjective(const float* x, const float* y, const float* z, float* u, float* v, int count) const
+    {
+        const float coeffX = m_coeffX, coeffY = m_coeffY;
+        const float halfX = m_halfXRes, halfY = m_halfYRes;
+        for (int i = 0; i < count; i++)
+        {
+            float invZ = 1.0f / z[i];
+            u[i] = coeffX * x[i] * invZ + halfX;
+            v[i] = halfY - coeffY * y[i] * invZ;
+        }
+    }
+
+    void toRealWorld(const float* u, const float* v, const float* z, float* x, float* y, int count) const
+    {
+        const float scaleX = m_xToZ / m_xRes, scaleY = m_yToZ / m_yRes;
+        const float halfX = 0.5f * m_xToZ, halfY = 0.5f * m_yToZ;
+        for (int i = 0; i < count; i++)
+        {
+            x[i] = (u[i] * scaleX - halfX) * z[i];
+            y[i] = (halfY - v[i] * scaleY) * z[i];
+        }
+    }
+
+private:
+    int m_xRes;
+    int m_yRes;
+    float m_xToZ;
+    float m_yToZ;
+    float m_coeffX;
+    float m_coeffY;
+    int m_halfXRes;
+    int m_halfYRes;
+};
+
+#endif // DEPTHPROJECTION_H
@@ -0,0 +1,251 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Native swipe and push detection from hand positions.
+
+    Keeps running sums of the hand positions inside a sliding time window
+    so that velocity (least squares fit), displacement and direction are
+    updated in constant time for every new point.
+*/
+
+#include "gesturedetector.h"
+#include <qmath.h>
+
+// min amount of points in the window before velocity is calculated
+const int MIN_SAMPLES = 3;
+
+// min movement in gesture direction between two points for them to be counted
+// as part of the gesture movement when searching for its start, in mm
+const double ONSET_MIN_STEP = 2.0;
+
+const double RAD_TO_DEG = 180.0 / M_PI;
+
+GestureDetector::Settings::Settings() :
+    windowLength(0.25),
+    swipeMinVelocity(600.0),
+    swipeMinDisplacement(120.0),
+    swipeMaxAngle(30.0),
+    pushMinVelocity(500.0),
+    pushMinDisplacement(100.0),
+    pushMaxAngle(30.0),
+    cooldown(0.5)
+{
+}
+
+GestureDetector::GestureDetector() :
+    m_velocity(0.0),
+    m_angle(0.0),
+    m_latency(0.0)
+{
+    reset();
+}
+
+void GestureDetector::setSettings(const Settings& settings)
+{
+    m_settings = settings;
+}
+
+GestureDetector::Settings GestureDetector::settings() const
+{
+    return m_settings;
+}
+
+void GestureDetector::reset()
+{
+    m_first = 0;
+    m_count = 0;
+    m_timeBase = 0.0;
+    m_hasTimeBase = false;
+    m_pointsSinceRebase = 0;
+    m_sumT = m_sumTT = 0.0;
+    m_sumX = m_sumY = m_sumZ = 0.0;
+    m_sumTX = m_sumTY = m_sumTZ = 0.0;
+    m_cooldownEnd = 0.0;
+}
+
+GestureDetector::Gesture GestureDetector::addPoint(qreal x, qreal y, qreal z, qreal time)
+{
+    if (!m_hasTimeBase)
+    {
+        m_timeBase = time;
+        m_hasTimeBase = true;
+    }
+
+    Sample sample;
+    sample.t = time - m_timeBase;
+    sample.x = x; sample.y = y; sample.z = z;
+
+    // slide the window
+    while (m_count > 0 && sample.t - m_samples[m_first].t > m_settings.windowLength) popOldest();
+    if (m_count == MAX_SAMPLES) popOldest();
+    push(sample);
+
+    if (++m_pointsSinceRebase >= MAX_SAMPLES) rebase();
+
+    if (time < m_cooldownEnd || m_count < MIN_SAMPLES) return GestureNone;
+
+    // least squares velocity over the window
+    double n = m_count;
+    double denom = n * m_sumTT - m_sumT * m_sumT;
+    if (denom <= 1e-12) return GestureNone;
+    double vx = (n * m_sumTX - m_sumT * m_sumX) / denom;
+    double vy = (n * m_sumTY - m_sumT * m_sumY) / denom;
+    double vz = (n * m_sumTZ - m_sumT * m_sumZ) / denom;
+
+    // displacement over the window
+    const Sample& oldest = m_samples[m_first];
+    const Sample& newest = m_samples[(m_first + m_count - 1) % MAX_SAMPLES];
+    double dx = newest.x - oldest.x;
+    double dy = newest.y - oldest.y;
+    double dz = newest.z - oldest.z;
+
+    Gesture gesture = GestureNone;
+    double speed = 0.0, angle = 0.0;
+    double dirX = 0.0, dirY = 0.0, dirZ = 0.0;
+
+    // push is movement toward the sensor, z decreasing
+    double pushAngle = qAtan2(qSqrt(vx * vx + vy * vy), -vz) * RAD_TO_DEG;
+    if (-vz > m_settings.pushMinVelocity && -dz > m_settings.pushMinDisplacement &&
+        pushAngle < m_settings.pushMaxAngle)
+    {
+        gesture = GesturePush;
+        speed = -vz; angle = pushAngle;
+        dirZ = -1.0;
+    }
+    else if (qAbs(vx) >= qAbs(vy))
+    {
+        double swipeAngle = qAtan2(qSqrt(vy * vy + vz * vz), qAbs(vx)) * RAD_TO_DEG;
+        if (qAbs(vx) > m_settings.swipeMinVelocity && dx * vx > 0.0 &&
+            qAbs(dx) > m_settings.swipeMinDisplacement && swipeAngle < m_settings.swipeMaxAngle)
+        {
+            gesture = vx > 0.0 ? GestureSwipeRight : GestureSwipeLeft;
+            speed = qAbs(vx); angle = swipeAngle;
+            dirX = vx > 0.0 ? 1.0 : -1.0;
+        }
+    }
+    else
+    {
+        double swipeAngle = qAtan2(qSqrt(vx * vx + vz * vz), qAbs(vy)) * RAD_TO_DEG;
+        if (qAbs(vy) > m_settings.swipeMinVelocity && dy * vy > 0.0 &&
+            qAbs(dy) > m_settings.swipeMinDisplacement && swipeAngle < m_settings.swipeMaxAngle)
+        {
+            gesture = vy > 0.0 ? GestureSwipeUp : GestureSwipeDown;
+            speed = qAbs(vy); angle = swipeAngle;
+            dirY = vy > 0.0 ? 1.0 : -1.0;
+        }
+    }
+
+    if (gesture != GestureNone)
+    {
+        m_velocity = speed / 1000.0;
+        m_angle = angle;
+        m_latency = sample.t - onsetTime(dirX, dirY, dirZ);
+
+        // start over so that the same movement isn't detected again
+        m_cooldownEnd = time + m_settings.cooldown;
+        m_first = 0;
+        m_count = 0;
+        m_sumT = m_sumTT = 0.0;
+        m_sumX = m_sumY = m_sumZ = 0.0;
+        m_sumTX = m_sumTY = m_sumTZ = 0.0;
+    }
+
+    return gesture;
+}
+
+qreal GestureDetector::velocity() const
+{
+    return m_velocity;
+}
+
+qreal GestureDetector::angle() const
+{
+    return m_angle;
+}
+
+qreal GestureDetector::latency() const
+{
+    return m_latency;
+}
+
+const char* GestureDetector::gestureName(Gesture gesture)
+{
+    switch (gesture)
+    {
+        case GestureSwipeUp: return "SwipeUp";
+        case GestureSwipeDown: return "SwipeDown";
+        case GestureSwipeLeft: return "SwipeLeft";
+        case GestureSwipeRight: return "SwipeRight";
+        case GesturePush: return "Push";
+        default: return "None";
+    }
+}
+
+void GestureDetector::push(const Sample& sample)
+{
+    m_samples[(m_first + m_count) % MAX_SAMPLES] = sample;
+    m_count++;
+
+    m_sumT += sample.t; m_sumTT += sample.t * sample.t;
+    m_sumX += sample.x; m_sumY += sample.y; m_sumZ += sample.z;
+    m_sumTX += sample.t * sample.x; m_sumTY += sample.t * sample.y; m_sumTZ += sample.t * sample.z;
+}
+
+void GestureDetector::popOldest()
+{
+    const Sample& sample = m_samples[m_first];
+
+    m_sumT -= sample.t; m_sumTT -= sample.t * sample.t;
+    m_sumX -= sample.x; m_sumY -= sample.y; m_sumZ -= sample.z;
+    m_sumTX -= sample.t * sample.x; m_sumTY -= sample.t * sample.y; m_sumTZ -= sample.t * sample.z;
+
+    m_first = (m_first + 1) % MAX_SAMPLES;
+    m_count--;
+}
+
+// moves time base to the oldest sample and recalculates the sums to get rid of
+// accumulated rounding errors, done once every MAX_SAMPLES points
+void GestureDetector::rebase()
+{
+    m_pointsSinceRebase = 0;
+    if (m_count == 0) return;
+
+    double shift = m_samples[m_first].t;
+    m_timeBase += shift;
+
+    int count = m_count;
+    int first = m_first;
+    m_count = 0;
+    m_sumT = m_sumTT = 0.0;
+    m_sumX = m_sumY = m_sumZ = 0.0;
+    m_sumTX = m_sumTY = m_sumTZ = 0.0;
+    for (int i = 0; i < count; i++)
+    {
+        Sample sample = m_samples[(first + i) % MAX_SAMPLES];
+        sample.t -= shift;
+        push(sample);
+    }
+}
+
+// searches backwards from the newest point for the point where movement
+// in the given direction started
+double GestureDetector::onsetTime(double dirX, double dirY, double dirZ) const
+{
+    int index = (m_first + m_count - 1) % MAX_SAMPLES;
+    double onset = m_samples[index].t;
+    for (int i = m_count - 2; i >= 0; i--)
+    {
+        int prev = (m_first + i) % MAX_SAMPLES;
+        double step = (m_samples[index].x - m_samples[prev].x) * dirX +
+                      (m_samples[index].y - m_samples[prev].y) * dirY +
+                      (m_samples[index].z - m_samples[prev].z) * dirZ;
+        if (step < ONSET_MIN_STEP) break;
+
+        onset = m_samples[prev].t;
+        index = prev;
+    }
+    return onset;
+}
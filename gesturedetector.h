@@ -0,0 +1,117 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Native swipe and push detection from hand positions.
+
+    Keeps running sums of the hand positions inside a sliding time window
+    so that velocity (least squares fit), displacement and direction are
+    updated in constant time for every new point.
+*/
+
+#ifndef GESTUREDETECTOR_H
+#define GESTUREDETECTOR_H
+
+#include <QtGlobal>
+
+class GestureDetector
+{
+public:
+
+    enum Gesture
+    {
+        GestureNone,
+        GestureSwipeUp,
+        GestureSwipeDown,
+        GestureSwipeLeft,
+        GestureSwipeRight,
+        GesturePush
+    };
+
+    // detection thresholds. distances are in mm, velocities in mm/s,
+    // times in seconds and angles in degrees
+    struct Settings
+    {
+        Settings();
+
+        // length of the sliding window velocity and displacement are calculated over
+        qreal windowLength;
+
+        qreal swipeMinVelocity;
+        qreal swipeMinDisplacement;
+        // max angle between movement and swipe axis
+        qreal swipeMaxAngle;
+
+        qreal pushMinVelocity;
+        qreal pushMinDisplacement;
+        // max angle between movement and the axis toward the sensor
+        qreal pushMaxAngle;
+
+        // time after a detected gesture during which no new gestures are detected
+        qreal cooldown;
+    };
+
+    GestureDetector();
+
+    void setSettings(const Settings& settings);
+    Settings settings() const;
+
+    // clears the window, called when hand tracking starts or stops
+    void reset();
+
+    // adds new raw hand position in real world coordinates and
+    // returns the gesture detected with it, if any
+    Gesture addPoint(qreal x, qreal y, qreal z, qreal time);
+
+    // velocity (m/s, like nite detectors) and angle of the last detected gesture
+    qreal velocity() const;
+    qreal angle() const;
+
+    // time in seconds from the start of the movement to the detection of the last gesture
+    qreal latency() const;
+
+    static const char* gestureName(Gesture gesture);
+
+private:
+    // doubles are used instead of qreal, which is float on some platforms,
+    // because the running sums lose precision with adds and subtracts
+    struct Sample
+    {
+        double t, x, y, z;
+    };
+
+    void push(const Sample& sample);
+    void popOldest();
+    void rebase();
+    double onsetTime(double dirX, double dirY, double dirZ) const;
+
+    // window size limit, at 60 fps this covers a second
+    static const int MAX_SAMPLES = 64;
+
+    Settings m_settings;
+
+    Sample m_samples[MAX_SAMPLES];
+    int m_first;
+    int m_count;
+
+    // sample times are relative to this for precision, it is moved forward
+    // and the sums are recalculated every MAX_SAMPLES points
+    double m_timeBase;
+    bool m_hasTimeBase;
+    int m_pointsSinceRebase;
+
+    // running sums over the samples in the window
+    double m_sumT, m_sumTT;
+    double m_sumX, m_sumY, m_sumZ;
+    double m_sumTX, m_sumTY, m_sumTZ;
+
+    double m_cooldownEnd;
+
+    qreal m_velocity;
+    qreal m_angle;
+    qreal m_latency;
+};
+
+#endif // GESTUREDETECTOR_H
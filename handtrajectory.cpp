@@ -0,0 +1,123 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Fixed size history of one hand's positions, grab states and times.
+
+    Written only from the tracker thread and read from any thread without
+    locking. Readers copy the samples inside a sequence lock and retry if
+    the writer was updating the history at the same time.
+*/
+
+#include "handtrajectory.h"
+
+// velocity is calculated between samples this far before and after the requested time, in seconds
+const qreal VELOCITY_HALF_WINDOW = 0.05;
+
+HandTrajectory::HandTrajectory() :
+    m_sequence(0),
+    m_count(0),
+    m_handId(0)
+{
+}
+
+void HandTrajectory::clear(quint32 handId)
+{
+    m_sequence.fetchAndAddOrdered(1);
+    m_count = 0;
+    m_handId = handId;
+    m_sequence.fetchAndAddOrdered(1);
+}
+
+void HandTrajectory::add(qreal x, qreal y, qreal z, qreal time, bool grab)
+{
+    m_sequence.fetchAndAddOrdered(1);
+
+    Sample& sample = m_samples[m_count % CAPACITY];
+    sample.x = x; sample.y = y; sample.z = z;
+    sample.time = time;
+    sample.grab = grab;
+    m_count++;
+
+    m_sequence.fetchAndAddOrdered(1);
+}
+
+quint32 HandTrajectory::handId() const
+{
+    quint32 handId;
+    int sequence;
+    do
+    {
+        // fetch and add of zero is used as a load with memory barrier
+        sequence = m_sequence.fetchAndAddOrdered(0);
+        handId = m_handId;
+    } while ((sequence & 1) || sequence != m_sequence.fetchAndAddOrdered(0));
+
+    return handId;
+}
+
+int HandTrajectory::snapshot(Sample* samples, int maxCount) const
+{
+    int copied;
+    int sequence;
+    do
+    {
+        sequence = m_sequence.fetchAndAddOrdered(0);
+        if (sequence & 1) continue;
+
+        // read the count once, the writer may change it while we copy. a changed count
+        // fails the sequence check, but the indices must stay in range until then
+        int count = m_count;
+        int available = count < CAPACITY ? count : CAPACITY;
+        copied = maxCount < available ? maxCount : available;
+        for (int i = 0; i < copied; i++)
+        {
+            samples[i] = m_samples[(count - copied + i) % CAPACITY];
+        }
+    } while ((sequence & 1) || sequence != m_sequence.fetchAndAddOrdered(0));
+
+    return copied;
+}
+
+int HandTrajectory::recent(qreal duration, Sample* samples, int maxCount) const
+{
+    int count = snapshot(samples, maxCount);
+    if (count == 0) return 0;
+
+    // drop samples older than duration from the beginning
+    qreal limit = samples[count - 1].time - duration;
+    int first = 0;
+    while (first < count && samples[first].time < limit) first++;
+    for (int i = first; i < count; i++) samples[i - first] = samples[i];
+
+    return count - first;
+}
+
+bool HandTrajectory::latest(Sample& sample) const
+{
+    return snapshot(&sample, 1) == 1;
+}
+
+bool HandTrajectory::velocityAt(qreal time, qreal& vx, qreal& vy, qreal& vz) const
+{
+    Sample samples[CAPACITY];
+    int count = snapshot(samples, CAPACITY);
+    if (count < 2) return false;
+
+    // last sample at or before the start and first sample at or after the end of the window,
+    // clamped to the available history
+    int begin = 0;
+    while (begin < count - 1 && samples[begin + 1].time <= time - VELOCITY_HALF_WINDOW) begin++;
+    int end = count - 1;
+    while (end > begin + 1 && samples[end - 1].time >= time + VELOCITY_HALF_WINDOW) end--;
+
+    qreal dt = samples[end].time - samples[begin].time;
+    if (dt <= 0.0) return false;
+
+    vx = (samples[end].x - samples[begin].x) / dt;
+    vy = (samples[end].y - samples[begin].y) / dt;
+    vz = (samples[end].z - samples[begin].z) / dt;
+    return true;
+}
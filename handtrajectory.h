@@ -0,0 +1,67 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Fixed size history of one hand's positions, grab states and times.
+
+    Written only from the tracker thread and read from any thread without
+    locking. Readers copy the samples inside a sequence lock and retry if
+    the writer was updating the history at the same time.
+*/
+
+#ifndef HANDTRAJECTORY_H
+#define HANDTRAJECTORY_H
+
+#include <QAtomicInt>
+
+class HandTrajectory
+{
+public:
+
+    struct Sample
+    {
+        // real world position in mm and nite time in seconds
+        qreal x, y, z;
+        qreal time;
+        bool grab;
+    };
+
+    // amount of samples kept, a bit over 4 seconds at 30 fps
+    static const int CAPACITY = 128;
+
+    HandTrajectory();
+
+    // writer side, only called from the tracker thread
+    void clear(quint32 handId);
+    void add(qreal x, qreal y, qreal z, qreal time, bool grab);
+
+    // reader side, can be called from any thread
+
+    // id of the hand the samples belong to, 0 if not used yet
+    quint32 handId() const;
+
+    // copies the most recent samples, oldest first, and returns their amount
+    int snapshot(Sample* samples, int maxCount) const;
+
+    // copies samples from the last duration seconds before the newest sample
+    int recent(qreal duration, Sample* samples, int maxCount) const;
+
+    bool latest(Sample& sample) const;
+
+    // velocity in mm/s at given time calculated over the samples around it
+    bool velocityAt(qreal time, qreal& vx, qreal& vy, qreal& vz) const;
+
+private:
+    // odd while writer is updating the samples
+    mutable QAtomicInt m_sequence;
+
+    Sample m_samples[CAPACITY];
+
+    // total amount of samples added since clear, next write position is m_count % CAPACITY
+    int m_count;
+    quint32 m_handId;
+};
+
+#endif // HANDTRAJECTORY_H
@@ -0,0 +1,307 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Renders depth frames of a hand in front of a flat background, for testing
+    and benchmarking without a sensor or recordings.
+
+    The hand is a palm with up to five extended fingers, a fist when none are
+    extended, placed at a real world position and rotated in the image plane.
+    Sensor noise grows with the square of the distance like Kinect's, and
+    pixels at the hand edges can drop out to zero like in the IR shadow.
+    Only the hand's bounding box is rasterized and the noisy background is
+    rendered once and copied, so a frame costs little more than a memcpy.
+*/
+
+#include <qmath.h>
+#include <cstring>
+
+#include "synthetichand.h"
+
+// hand dimensions in mm, palm is an ellipse around the hand point
+const float PALM_HALF_WIDTH = 42.0f;
+const float PALM_HALF_HEIGHT = 50.0f;
+const float FINGER_WIDTH = 17.0f;
+
+// furthest a finger tip reaches from the palm center, for the bounding box
+const float HAND_EXTENT = 125.0f;
+
+// amount of precalculated normal samples, power of two
+const int NORMAL_TABLE_SIZE = 4096;
+
+// noisy background is rendered once this many pixels larger than a frame and
+// copied from a random offset, so that noise changes between frames
+const int BACKGROUND_SHIFT = 4096;
+
+struct Finger
+{
+    // base in hand coordinates, mm right and up from palm center
+    float baseX, baseY;
+
+    // from straight up, positive towards the right
+    float angle;
+    float length;
+};
+
+// index, middle, ring, little and thumb of a right hand facing the sensor
+static const Finger FINGERS[5] = {
+    { -22.0f, 35.0f, -0.15f, 70.0f },
+    { -7.0f, 40.0f, -0.05f, 78.0f },
+    { 8.0f, 38.0f, 0.05f, 72.0f },
+    { 22.0f, 30.0f, 0.2f, 58.0f },
+    { -38.0f, -5.0f, -1.0f, 55.0f }
+};
+
+SyntheticHand::Pose::Pose() :
+    rotation(0.0),
+    fingers(5)
+{
+    position.X = 0;
+    position.Y = 0;
+    position.Z = 900;
+}
+
+SyntheticHand::SyntheticHand(const DepthProjection& projection) :
+    m_projection(projection),
+    m_backgroundDepth(1800),
+    m_depthNoise(0.0),
+    m_dropoutRate(0.0),
+    m_pointNoise(0.0),
+    m_random(1),
+    m_backgroundValid(false)
+{
+}
+
+void SyntheticHand::setProjection(const DepthProjection& projection)
+{
+    m_projection = projection;
+    m_backgroundValid = false;
+}
+
+void SyntheticHand::setBackgroundDepth(XnDepthPixel depth)
+{
+    m_backgroundDepth = depth;
+    m_backgroundValid = false;
+}
+
+void SyntheticHand::setNoise(qreal depthNoise, qreal dropoutRate, qreal pointNoise, quint32 seed)
+{
+    m_depthNoise = depthNoise;
+    m_dropoutRate = dropoutRate;
+    m_pointNoise = pointNoise;
+
+    // xorshift gets stuck at zero
+    m_random = seed ? seed : 1;
+
+    m_normals.resize(NORMAL_TABLE_SIZE);
+    for (int i = 0; i < NORMAL_TABLE_SIZE; i++) m_normals[i] = gaussian();
+    m_backgroundValid = false;
+}
+
+// xorshift32, plenty for noise and cheap enough to call per pixel
+quint32 SyntheticHand::random()
+{
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random;
+}
+
+// box-muller
+qreal SyntheticHand::gaussian()
+{
+    qreal u1 = (random() + 1.0) / 4294967297.0;
+    qreal u2 = random() / 4294967296.0;
+    return qSqrt(-2.0 * qLn(u1)) * qCos(2.0 * M_PI * u2);
+}
+
+XnDepthPixel SyntheticHand::noisyDepth(float depth, float deviation)
+{
+    float value = depth + deviation * m_normals[random() & (NORMAL_TABLE_SIZE - 1)] + 0.5f;
+    if (value < 1.0f) return 1;
+    if (value > 65535.0f) return 65535;
+    return (XnDepthPixel)value;
+}
+
+// where a * k^2 + b * k + c <= 0 for a > 0, false if nowhere
+static inline bool solveQuadratic(float a, float b, float c, float& start, float& end)
+{
+    const float discriminant = b * b - 4.0f * a * c;
+    if (a <= 0.0f || discriminant < 0.0f) return false;
+    const float root = qSqrt(discriminant);
+    start = (-b - root) / (2.0f * a);
+    end = (-b + root) / (2.0f * a);
+    return true;
+}
+
+// narrows [start, end] to where p + q * k >= 0
+static inline void clipLinear(float p, float q, float& start, float& end)
+{
+    if (q > 0.0f) start = qMax(start, -p / q);
+    else if (q < 0.0f) end = qMin(end, -p / q);
+    else if (p < 0.0f)
+    {
+        start = 1.0f;
+        end = 0.0f;
+    }
+}
+
+XnPoint3D SyntheticHand::render(const Pose& pose, XnDepthPixel* frame)
+{
+    const int xRes = m_projection.xRes(), yRes = m_projection.yRes();
+    const bool noise = m_depthNoise > 0.0 && !m_normals.isEmpty();
+
+    // background, noise deviation grows with square of the distance. rendered
+    // once and copied, memcpy is a lot faster than a 16 bit fill loop
+    if (!m_backgroundValid)
+    {
+        m_background.resize(xRes * yRes + BACKGROUND_SHIFT);
+        if (noise && m_backgroundDepth > 0)
+        {
+            float deviation = m_depthNoise * (m_backgroundDepth / 1000.0f) * (m_backgroundDepth / 1000.0f);
+            for (int i = 0; i < m_background.size(); i++) m_background[i] = noisyDepth(m_backgroundDepth, deviation);
+        }
+        else
+        {
+            m_background.fill(m_backgroundDepth);
+        }
+        m_backgroundValid = true;
+    }
+    int shift = noise ? random() % BACKGROUND_SHIFT : 0;
+    memcpy(frame, m_background.constData() + shift, xRes * yRes * sizeof(XnDepthPixel));
+
+    // pixels per mm at hand distance, from projecting points a meter apart
+    XnPoint3D center = m_projection.toProjective(pose.position);
+    XnPoint3D offset = pose.position;
+    offset.X += 1000.0f;
+    offset.Y += 1000.0f;
+    XnPoint3D offsetProjective = m_projection.toProjective(offset);
+    const float scaleX = (offsetProjective.X - center.X) / 1000.0f;
+    const float scaleY = (center.Y - offsetProjective.Y) / 1000.0f;
+
+    int left = qMax(0, (int)(center.X - HAND_EXTENT * scaleX));
+    int right = qMin(xRes - 1, (int)(center.X + HAND_EXTENT * scaleX) + 1);
+    int top = qMax(0, (int)(center.Y - HAND_EXTENT * scaleY));
+    int bottom = qMin(yRes - 1, (int)(center.Y + HAND_EXTENT * scaleY) + 1);
+
+    XnPoint3D handPoint = pose.position;
+    if (m_pointNoise > 0.0)
+    {
+        handPoint.X += m_pointNoise * gaussian();
+        handPoint.Y += m_pointNoise * gaussian();
+        handPoint.Z += m_pointNoise * gaussian();
+    }
+    if (left > right || top > bottom || pose.position.Z <= 0) return handPoint;
+
+    const int boxWidth = right - left + 1, boxHeight = bottom - top + 1;
+    m_handMask.fill(0, boxWidth * boxHeight);
+
+    const float cosR = qCos(pose.rotation), sinR = qSin(pose.rotation);
+    const float stepU = cosR / scaleX, stepV = -sinR / scaleX;
+    const float palmU = 1.0f / (PALM_HALF_WIDTH * PALM_HALF_WIDTH), palmV = 1.0f / (PALM_HALF_HEIGHT * PALM_HALF_HEIGHT);
+    const int fingers = qBound(0, pose.fingers, 5);
+    const float handDepth = pose.position.Z;
+    const float handDeviation = m_depthNoise * (handDepth / 1000.0f) * (handDepth / 1000.0f);
+    const float halfFinger = FINGER_WIDTH / 2.0f;
+
+    // along and across finger per pixel step
+    float alongStep[5], acrossStep[5], fingerSin[5], fingerCos[5];
+    for (int f = 0; f < fingers; f++)
+    {
+        fingerSin[f] = qSin(FINGERS[f].angle);
+        fingerCos[f] = qCos(FINGERS[f].angle);
+        alongStep[f] = stepU * fingerSin[f] + stepV * fingerCos[f];
+        acrossStep[f] = stepU * fingerCos[f] - stepV * fingerSin[f];
+    }
+
+    // palm and fingers are convex, so each covers one span of a row. spans are
+    // solved from the shape equations with hand coordinates linear along the row
+    for (int y = top; y <= bottom; y++)
+    {
+        XnDepthPixel* row = frame + y * xRes + left;
+        uchar* maskRow = m_handMask.data() + (y - top) * boxWidth;
+
+        // hand coordinates of the row's first pixel, mm right and up from palm center
+        const float dx = (left - center.X) / scaleX;
+        const float dy = (center.Y - y) / scaleY;
+        const float u = dx * cosR + dy * sinR;
+        const float v = dy * cosR - dx * sinR;
+
+        float spanStart[6], spanEnd[6];
+        int spans = 0;
+
+        if (solveQuadratic(stepU * stepU * palmU + stepV * stepV * palmV,
+                           2.0f * (u * stepU * palmU + v * stepV * palmV),
+                           u * u * palmU + v * v * palmV - 1.0f,
+                           spanStart[spans], spanEnd[spans])) spans++;
+
+        for (int f = 0; f < fingers; f++)
+        {
+            const Finger& finger = FINGERS[f];
+            const float fu = u - finger.baseX, fv = v - finger.baseY;
+            const float along = fu * fingerSin[f] + fv * fingerCos[f];
+            const float across = fu * fingerCos[f] - fv * fingerSin[f];
+
+            // straight part, 0 <= along <= length and |across| <= half width
+            float start = -1e9f, end = 1e9f;
+            clipLinear(along, alongStep[f], start, end);
+            clipLinear(finger.length - along, -alongStep[f], start, end);
+            clipLinear(halfFinger - across, -acrossStep[f], start, end);
+            clipLinear(halfFinger + across, acrossStep[f], start, end);
+
+            // rounded tip, touches the straight part so the union is one span
+            const float beyond = along - finger.length;
+            float tipStart, tipEnd;
+            if (solveQuadratic(alongStep[f] * alongStep[f] + acrossStep[f] * acrossStep[f],
+                               2.0f * (beyond * alongStep[f] + across * acrossStep[f]),
+                               beyond * beyond + across * across - halfFinger * halfFinger,
+                               tipStart, tipEnd))
+            {
+                start = start <= end ? qMin(start, tipStart) : tipStart;
+                end = qMax(end, tipEnd);
+            }
+            if (start > end) continue;
+
+            spanStart[spans] = start;
+            spanEnd[spans] = end;
+            spans++;
+        }
+
+        for (int i = 0; i < spans; i++)
+        {
+            int first = qMax(0, (int)qCeil(spanStart[i]));
+            int last = qMin(boxWidth - 1, (int)qFloor(spanEnd[i]));
+            if (first > last) continue;
+
+            if (noise)
+            {
+                for (int x = first; x <= last; x++) row[x] = noisyDepth(handDepth, handDeviation);
+            }
+            else
+            {
+                const XnDepthPixel depth = (XnDepthPixel)(handDepth + 0.5f);
+                for (int x = first; x <= last; x++) row[x] = depth;
+            }
+            memset(maskRow + first, 1, last - first + 1);
+        }
+    }
+
+    // dropouts on the left and right edges of the hand where the IR shadow falls
+    if (m_dropoutRate > 0.0)
+    {
+        const quint32 limit = (quint32)(qMin(m_dropoutRate, 1.0) * 4294967295.0);
+        for (int y = 0; y < boxHeight; y++)
+        {
+            const uchar* maskRow = m_handMask.constData() + y * boxWidth;
+            XnDepthPixel* row = frame + (y + top) * xRes + left;
+            for (int x = 1; x < boxWidth - 1; x++)
+            {
+                if (maskRow[x] && (!maskRow[x - 1] || !maskRow[x + 1]) && random() <= limit) row[x] = 0;
+            }
+        }
+    }
+
+    return handPoint;
+}
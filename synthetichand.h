@@ -0,0 +1,85 @@
+/*
+    Air Cursor library for Qt applications using Kinect
+    Copyright (C) 2012 Tuomas Haapala, Nemein
+
+    ---
+
+    Renders depth frames of a hand in front of a flat background, for testing
+    and benchmarking without a sensor or recordings.
+
+    The hand is a palm with up to five extended fingers, a fist when none are
+    extended, placed at a real world position and rotated in the image plane.
+    Sensor noise grows with the square of the distance like Kinect's, and
+    pixels at the hand edges can drop out to zero like in the IR shadow.
+    Only the hand's bounding box is rasterized and the noisy background is
+    rendered once and copied, so a frame costs little more than a memcpy.
+*/
+
+#ifndef SYNTHETICHAND_H
+#define SYNTHETICHAND_H
+
+#include <QVector>
+#include <XnTypes.h>
+
+#include "depthprojection.h"
+
+class SyntheticHand
+{
+public:
+
+    struct Pose
+    {
+        Pose();
+
+        // palm center in real world mm
+        XnPoint3D position;
+
+        // counterclockwise in the image plane in radians, 0 points fingers up
+        qreal rotation;
+
+        // extended fingers from index to thumb, 0 is a fist
+        int fingers;
+    };
+
+    // frames have the projection's resolution, default Kinect 640x480
+    SyntheticHand(const DepthProjection& projection = DepthProjection());
+
+    void setProjection(const DepthProjection& projection);
+    const DepthProjection& projection() const { return m_projection; }
+
+    // background depth in mm, 0 for no background
+    void setBackgroundDepth(XnDepthPixel depth);
+
+    // depth noise standard deviation in mm at 1 m, share of hand edge pixels
+    // dropped out and hand point noise standard deviation in mm
+    void setNoise(qreal depthNoise, qreal dropoutRate, qreal pointNoise, quint32 seed = 1);
+
+    // renders the pose to frame of xRes * yRes pixels and returns the hand point NITE would report
+    XnPoint3D render(const Pose& pose, XnDepthPixel* frame);
+
+private:
+    inline quint32 random();
+    qreal gaussian();
+
+    // depth with noise of given standard deviation from the normal table
+    inline XnDepthPixel noisyDepth(float depth, float deviation);
+
+    DepthProjection m_projection;
+    XnDepthPixel m_backgroundDepth;
+    qreal m_depthNoise;
+    qreal m_dropoutRate;
+    qreal m_pointNoise;
+    quint32 m_random;
+
+    // precalculated standard normal samples, indexed randomly per pixel
+    QVector<float> m_normals;
+
+    // noisy background with extra pixels to copy from at an offset
+    QVector<XnDepthPixel> m_background;
+    bool m_backgroundValid;
+
+    // hand pixels of the last bounding box for finding edges
+    QVector<uchar> m_handMask;
+};
+
+#endif // SYNTHETICHAND_H